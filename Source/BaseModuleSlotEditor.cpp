@@ -18,7 +18,8 @@ BaseModuleSlotEditor::BaseModuleSlotEditor(
     slotIndex(sIndex),
     slotID(info.slotID),
     processor(p),
-    apvts(state)
+    apvts(state),
+    slotMeter(p.slots[cIndex][sIndex]->meter)
 {
     // Title
 
@@ -93,6 +94,11 @@ BaseModuleSlotEditor::BaseModuleSlotEditor(
                 slotIndex);
         };
 
+
+    // Meters
+
+    addAndMakeVisible(slotMeter);
+
 }
 
 
@@ -118,6 +124,9 @@ void BaseModuleSlotEditor::resized()
     removeButton.setBounds(
         r.removeFromRight(30));
 
+    slotMeter.setBounds(
+        r.removeFromRight(30).reduced(2, 0));
+
 
     layoutEditor(r);
 }
\ No newline at end of file
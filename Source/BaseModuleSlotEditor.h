@@ -25,6 +25,7 @@
 #endif
 
 #include "PluginProcessor.h"
+#include "SlotMeterComponent.h"
 
 class BaseModuleSlotEditor : public juce::Component
 {
@@ -60,6 +61,9 @@ protected:
 
     juce::TextButton removeButton{ "-" };
 
+    // Slot input / output levels
+    SlotMeterComponent slotMeter;
+
     std::unique_ptr<
         juce::AudioProcessorValueTreeState::ButtonAttachment>
         enableToggleAttachment;
@@ -2,6 +2,7 @@
 // Optical-style compressor inspired by LA-2A, SSL G-Bus, and Neve 33609.
 
 #include "BasicCompressor.h"
+#include "FastMath.h"
 
 BasicCompressor::BasicCompressor() {}
 BasicCompressor::~BasicCompressor() {}
@@ -24,6 +25,24 @@ void BasicCompressor::prepare(const juce::dsp::ProcessSpec& spec)
     detectorFilterL.setCutoffFrequency(800.0f);
     detectorFilterR.setCutoffFrequency(800.0f);
 
+    const auto maxBlock = (size_t) juce::jmax(1, (int) spec.maximumBlockSize);
+    levelScratch  .assign(maxBlock, 0.0f);
+    levelDbScratch.assign(maxBlock, 0.0f);
+    attackScratch .assign(maxBlock, 0.0f);
+
+    const int maxLookahead = (int) std::ceil(kMaxLookaheadMs * 0.001 * sampleRate);
+    const int ringSize     = juce::nextPowerOfTwo(maxLookahead + 1);
+    lookaheadMask = ringSize - 1;
+
+    for (auto& ring : lookaheadRing)
+        ring.assign((size_t) ringSize, 0.0f);
+
+    peakDequeIndex.assign((size_t) ringSize, 0);
+    peakDequeValue.assign((size_t) ringSize, 0.0f);
+
+    lookaheadSamples    = juce::jlimit(0, maxLookahead, (int) std::round(lookaheadMs * 0.001 * sampleRate));
+    lookaheadFadeLength = juce::jmax(1, (int) std::round(kLookaheadFadeMs * 0.001 * sampleRate));
+
     updateTimeCoefficients();
     reset();
 }
@@ -36,72 +55,223 @@ void BasicCompressor::processBlock(juce::AudioBuffer<float>& buffer)
     float* leftData  = buffer.getWritePointer(0);
     float* rightData = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
 
+    // Chunks no longer than the scratch buffers
+    const int chunkSize = juce::jmax(1, (int) levelScratch.size());
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const int n = juce::jmin(chunkSize, numSamples - start);
+        processChunk(leftData + start, rightData != nullptr ? rightData + start : nullptr, n);
+    }
+}
+
+void BasicCompressor::processChunk(float* leftData, float* rightData, int numSamples)
+{
+    float* level   = levelScratch.data();
+    float* levelDb = levelDbScratch.data();
+    float* attack  = attackScratch.data();
+
     // Pre-compute linear gains from dB params
     const float inputLinear  = juce::Decibels::decibelsToGain(inputGainDb);
     const float outputLinear = juce::Decibels::decibelsToGain(outputGainDb);
 
+    // ---- Input gain stage ----
+    juce::FloatVectorOperations::multiply(leftData, inputLinear, numSamples);
+    if (rightData != nullptr)
+        juce::FloatVectorOperations::multiply(rightData, inputLinear, numSamples);
+
+    // ---- Detector: low-mid filtered, linked RMS ----
+    // Filter the detector signal to weight low-mid frequencies, and keep
+    // the linked power: mean of the squares
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float detL = detectorFilterL.processSample(0, leftData[i]);
+        level[i] = detL * detL;
+    }
+
+    if (rightData != nullptr)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float detR = detectorFilterR.processSample(0, rightData[i]);
+            level[i] = 0.5f * (level[i] + detR * detR);
+        }
+    }
+
+    // ---- Lookahead ----
+    // The detector runs on the undelayed input, the gain lands on the delayed
+    // audio, and the peak hold spans the gap
+    if (lookaheadSamples > 0)
+        applyLookaheadPeakHold(level, numSamples);
+
+    if (lookaheadSamples > 0 || lookaheadFadeRemaining > 0)
+    {
+        delayByLookahead(0, leftData, numSamples);
+        if (rightData != nullptr)
+            delayByLookahead(1, rightData, numSamples);
+
+        advanceLookahead(numSamples);
+    }
+
+    // Level in dB straight from the power (10 log10), then the RMS itself.
+    // The epsilon avoids log(0).
     for (int i = 0; i < numSamples; ++i)
     {
-        // ---- Input gain stage ----
-        float inL = leftData[i] * inputLinear;
-        float inR = (rightData != nullptr) ? rightData[i] * inputLinear : inL;
-
-        // ---- Detector: low-mid filtered, linked RMS ----
-        // Filter the detector signal to weight low-mid frequencies
-        float detL = detectorFilterL.processSample(0, inL);
-        float detR = (rightData != nullptr)
-                        ? detectorFilterR.processSample(0, inR)
-                        : detL;
-
-        // Linked RMS: sum of squares, averaged, then sqrt
-        double instantPower = 0.5 * ((double)detL * detL + (double)detR * detR);
-        double instantRms   = std::sqrt(instantPower + 1e-18); // epsilon avoids log(0)
-
-        // ---- Program-dependent envelope follower ----
-        // LA-2A style: attack speeds up for louder signals,
-        // release slows down for sustained content (SSL "auto" release feel)
-        double inputDb = juce::Decibels::gainToDecibels((float)instantRms);
-
-        double aCoeff = computeAttackCoeff(inputDb);
-        double rCoeff = computeReleaseCoeff(inputDb);
-
-        if (instantRms > envelopeState)
-            envelopeState = aCoeff * envelopeState + (1.0 - aCoeff) * instantRms;
+        const float power = level[i] + 1e-18f;
+        levelDb[i] = juce::jmax(-100.0f, 3.01029996f * FastMath::log2(power));
+        level[i]   = std::sqrt(power);
+    }
+
+    // ---- Program-dependent envelope follower ----
+    // LA-2A style: attack speeds up for louder signals,
+    // release slows down for sustained content (SSL "auto" release feel).
+    // The attack depends only on the input, so its weights come first.
+    for (int i = 0; i < numSamples; ++i)
+        attack[i] = computeAttackWeight(levelDb[i]);
+
+    float envelope = envelopeState;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float x = level[i];
+
+        if (x > envelope)
+            envelope += attack[i] * (x - envelope);
         else
-            envelopeState = rCoeff * envelopeState + (1.0 - rCoeff) * instantRms;
+            envelope += computeReleaseWeight(FastMath::gainToDecibels(envelope)) * (x - envelope);
+
+        level[i] = envelope;
+    }
+
+    envelopeState = envelope;
 
-        // ---- Gain computer (soft knee, Neve-style) ----
-        double envDb = juce::Decibels::gainToDecibels((float)envelopeState);
-        double targetGrDb = computeGainReductionDb(envDb);
+    // ---- Gain computer (soft knee, Neve-style) ----
+    for (int i = 0; i < numSamples; ++i)
+        levelDb[i] = computeGainReductionDb(FastMath::gainToDecibels(level[i]));
+
+    // ---- Smooth gain reduction (models optical cell lag) ----
+    // A secondary smoother on the GR signal itself gives the
+    // characteristic optical "rounding" — gain reduction never snaps
+    float gainReduction = gainReductionState;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const float targetGrDb = levelDb[i];
 
-        // ---- Smooth gain reduction (models optical cell lag) ----
-        // A secondary smoother on the GR signal itself gives the
-        // characteristic optical "rounding" — gain reduction never snaps
-        gainReductionState = gainReductionState * 0.9995
-                           + targetGrDb         * 0.0005;
+        gainReduction = gainReduction * 0.9995f + targetGrDb * 0.0005f;
 
         // For very fast transients above threshold, let GR move faster
         // (models the LED driving harder into the optical cell)
-        if (targetGrDb < gainReductionState)
-            gainReductionState = gainReductionState * 0.995
-                               + targetGrDb         * 0.005;
+        if (targetGrDb < gainReduction)
+            gainReduction = gainReduction * 0.995f + targetGrDb * 0.005f;
 
-        double grLinear = juce::Decibels::decibelsToGain((float)gainReductionState);
+        levelDb[i] = gainReduction;
+    }
 
-        // ---- Apply gain reduction + output gain ----
-        leftData[i] = (float)(inL * grLinear) * outputLinear;
+    gainReductionState = gainReduction;
 
-        if (rightData != nullptr)
-            rightData[i] = (float)(inR * grLinear) * outputLinear;
+    // ---- Apply gain reduction + output gain ----
+    for (int i = 0; i < numSamples; ++i)
+        levelDb[i] = FastMath::decibelsToGain(levelDb[i]) * outputLinear;
+
+    juce::FloatVectorOperations::multiply(leftData, levelDb, numSamples);
+    if (rightData != nullptr)
+        juce::FloatVectorOperations::multiply(rightData, levelDb, numSamples);
+}
+
+void BasicCompressor::processLatencyOnly(juce::AudioBuffer<float>& buffer)
+{
+    if (lookaheadSamples <= 0 && lookaheadFadeRemaining <= 0)
+        return;
+
+    const int numSamples = buffer.getNumSamples();
+
+    for (int ch = 0; ch < juce::jmin(2, buffer.getNumChannels()); ++ch)
+        delayByLookahead(ch, buffer.getWritePointer(ch), numSamples);
+
+    advanceLookahead(numSamples);
+}
+
+void BasicCompressor::delayByLookahead(int channel, float* data, int numSamples)
+{
+    float* ring = lookaheadRing[channel].data();
+    int pos = lookaheadWritePos;
+
+    // Past the fade: a single tap
+    const int faded = juce::jlimit(0, numSamples, lookaheadFadeRemaining);
+
+    for (int i = 0; i < faded; ++i)
+    {
+        ring[pos] = data[i];
+
+        const float to   = ring[(pos - lookaheadSamples)  & lookaheadMask];
+        const float from = ring[(pos - lookaheadFadeFrom) & lookaheadMask];
+        const float t    = (float) (lookaheadFadeRemaining - i) / (float) lookaheadFadeLength;
+
+        data[i] = to + t * (from - to);
+        pos = (pos + 1) & lookaheadMask;
+    }
+
+    for (int i = faded; i < numSamples; ++i)
+    {
+        ring[pos] = data[i];
+        data[i]   = ring[(pos - lookaheadSamples) & lookaheadMask];
+        pos = (pos + 1) & lookaheadMask;
+    }
+}
+
+void BasicCompressor::advanceLookahead(int numSamples)
+{
+    lookaheadWritePos      = (lookaheadWritePos + numSamples) & lookaheadMask;
+    lookaheadFadeRemaining = juce::jmax(0, lookaheadFadeRemaining - numSamples);
+}
+
+void BasicCompressor::applyLookaheadPeakHold(float* power, int numSamples)
+{
+    const int capacity = lookaheadMask + 1;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const juce::int64 now = samplesSeen++;
+        const float value     = power[i];
+
+        // Anything no louder than the newest sample can never be the
+        // maximum again
+        while (peakDequeSize > 0
+               && peakDequeValue[(size_t) ((peakDequeHead + peakDequeSize - 1) & lookaheadMask)] <= value)
+            --peakDequeSize;
+
+        const int tail = (peakDequeHead + peakDequeSize) & lookaheadMask;
+        peakDequeIndex[(size_t) tail] = now;
+        peakDequeValue[(size_t) tail] = value;
+        ++peakDequeSize;
+
+        // Drop what has slid out of the window [now - lookahead, now]
+        while (peakDequeIndex[(size_t) peakDequeHead] < now - lookaheadSamples)
+        {
+            peakDequeHead = (peakDequeHead + 1) & lookaheadMask;
+            --peakDequeSize;
+        }
+
+        jassert(peakDequeSize <= capacity);
+        power[i] = peakDequeValue[(size_t) peakDequeHead];
     }
 }
 
 void BasicCompressor::reset()
 {
-    envelopeState      = 0.0;
-    gainReductionState = 0.0;
+    envelopeState      = 0.0f;
+    gainReductionState = 0.0f;
     detectorFilterL.reset();
     detectorFilterR.reset();
+
+    for (auto& ring : lookaheadRing)
+        std::fill(ring.begin(), ring.end(), 0.0f);
+
+    lookaheadWritePos      = 0;
+    lookaheadFadeRemaining = 0;
+    peakDequeHead = 0;
+    peakDequeSize = 0;
 }
 
 // ---------------------------------------------------------------------------
@@ -110,29 +280,28 @@ void BasicCompressor::reset()
 // Within knee: gradually blend in compression (Neve 33609 style smooth knee)
 // Above (threshold + knee/2): full ratio compression
 // ---------------------------------------------------------------------------
-double BasicCompressor::computeGainReductionDb(double inputDb) const
+float BasicCompressor::computeGainReductionDb(float inputDb) const
 {
-    const double T  = (double)thresholdDb;
-    const double R  = (double)ratio;
-    const double kH = (double)kneeWidthDb * 0.5;
+    const float T  = thresholdDb;
+    const float R  = ratio;
+    const float kH = kneeWidthDb * 0.5f;
 
     // Below knee: unity
     if (inputDb < T - kH)
-        return 0.0;
+        return 0.0f;
 
     // Within soft knee
     if (inputDb <= T + kH)
     {
-        double x = inputDb - (T - kH);
-        double kneeRange = kneeWidthDb;
+        const float x = (inputDb - (T - kH)) / kneeWidthDb;
         // Quadratic blend from 1:1 to full ratio across knee
-        double blendedSlope = 1.0 + (R - 1.0) * (x / kneeRange) * (x / kneeRange);
-        double outputDb = (T - kH) + x / blendedSlope;
+        const float blendedSlope = 1.0f + (R - 1.0f) * x * x;
+        const float outputDb = (T - kH) + x * kneeWidthDb / blendedSlope;
         return outputDb - inputDb;
     }
 
     // Above knee: full ratio
-    double outputDb = T + (inputDb - T) / R;
+    const float outputDb = T + (inputDb - T) / R;
     return outputDb - inputDb;
 }
 
@@ -141,34 +310,29 @@ double BasicCompressor::computeGainReductionDb(double inputDb) const
 // Attack: faster when signal is well above threshold (LED drives harder)
 // Release: slower for sustained signals, faster for brief transients
 // ---------------------------------------------------------------------------
-double BasicCompressor::computeAttackCoeff(double inputDb) const
+float BasicCompressor::computeAttackWeight(float inputDb) const
 {
     // How far above threshold is the signal?
-    double overdrive = inputDb - (double)thresholdDb;
-    overdrive = juce::jmax(0.0, overdrive);
+    const float overdrive = juce::jmax(0.0f, inputDb - thresholdDb);
 
     // At 0 dB overdrive: use nominal attack time
     // At 20 dB overdrive: attack is ~3x faster (more light hits the cell)
-    double scaledAttackMs = (double)attackMs / (1.0 + overdrive * 0.1);
-    scaledAttackMs = juce::jmax(0.1, scaledAttackMs);
+    // Never faster than 0.1 ms
+    const float speedUp = juce::jmin(1.0f + overdrive * 0.1f, attackMs * 10.0f);
 
-    double attackSamples = (scaledAttackMs / 1000.0) * sampleRate;
-    return std::exp(-1.0 / attackSamples);
+    return FastMath::oneMinusExpNeg(attackPerSample * speedUp);
 }
 
-double BasicCompressor::computeReleaseCoeff(double inputDb) const
+float BasicCompressor::computeReleaseWeight(float envelopeDb) const
 {
     // SSL-style: if signal has been sustained above threshold, release slows
     // We approximate this by scaling release with envelope level
-    double envelopeDb = juce::Decibels::gainToDecibels((float)envelopeState);
-    double sustainAmount = juce::jmax(0.0, envelopeDb - (double)thresholdDb);
+    const float sustainAmount = juce::jmax(0.0f, envelopeDb - thresholdDb);
 
     // Up to 2x longer release for heavily compressed sustained signals
-    double scaledReleaseMs = (double)releaseMs * (1.0 + sustainAmount * 0.05);
-    scaledReleaseMs = juce::jmin(scaledReleaseMs, (double)releaseMs * 2.0);
+    const float slowDown = juce::jmin(1.0f + sustainAmount * 0.05f, 2.0f);
 
-    double releaseSamples = (scaledReleaseMs / 1000.0) * sampleRate;
-    return std::exp(-1.0 / releaseSamples);
+    return FastMath::oneMinusExpNeg(releasePerSample / slowDown);
 }
 
 // ---------------------------------------------------------------------------
@@ -219,11 +383,46 @@ void BasicCompressor::setOutputGain(float dB)
     if (outputGainDb != clamped) outputGainDb = clamped;
 }
 
+void BasicCompressor::setLookahead(float ms)
+{
+    lookaheadMs = juce::jlimit(0.0f, kMaxLookaheadMs, ms);
+
+    if (lookaheadRing[0].empty())
+        return;  // not prepared yet -- prepare() sizes it
+
+    // Picked up by a later call once the current fade is over
+    if (lookaheadFadeRemaining > 0)
+        return;
+
+    const int maxLookahead = (int) std::ceil(kMaxLookaheadMs * 0.001 * sampleRate);
+    const int newSamples   = juce::jlimit(0, maxLookahead, (int) std::round(lookaheadMs * 0.001 * sampleRate));
+
+    if (newSamples != lookaheadSamples)
+    {
+        // The rings aren't written while there is no lookahead - what they
+        // hold is from the last time there was, so don't play it back
+        if (lookaheadSamples == 0)
+        {
+            for (auto& ring : lookaheadRing)
+                std::fill(ring.begin(), ring.end(), 0.0f);
+
+            lookaheadWritePos = 0;
+        }
+
+        // Reading both taps through the fade rather than jumping between them
+        lookaheadFadeFrom      = lookaheadSamples;
+        lookaheadFadeRemaining = lookaheadFadeLength;
+        lookaheadSamples       = newSamples;
+
+        // The window changed under the deque - start it over
+        peakDequeHead = 0;
+        peakDequeSize = 0;
+    }
+}
+
 void BasicCompressor::updateTimeCoefficients()
 {
     if (sampleRate <= 0.0) return;
-    double attackSamples  = (attackMs  / 1000.0) * sampleRate;
-    double releaseSamples = (releaseMs / 1000.0) * sampleRate;
-    attackCoeff  = std::exp(-1.0 / attackSamples);
-    releaseCoeff = std::exp(-1.0 / releaseSamples);
+    attackPerSample  = (float) (1000.0 / (attackMs  * sampleRate));
+    releasePerSample = (float) (1000.0 / (releaseMs * sampleRate));
 }
\ No newline at end of file
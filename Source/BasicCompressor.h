@@ -2,6 +2,17 @@
 // Optical-style compressor inspired by LA-2A program-dependent behaviour,
 // SSL G-Bus glue, and Neve 33609 soft-knee musicality.
 // Linked stereo detector, shared gain reduction applied equally to both channels.
+//
+// Processed in block passes: everything that is per-sample independent
+// (levels in dB, attack weights, the gain computer, dB to gain) runs as a
+// flat loop over the block with FastMath's log2 / exp2, and only the two
+// true recursions - the envelope follower and the optical GR smoother -
+// stay sample by sample.
+//
+// Lookahead (0 - kMaxLookaheadMs): the audio is delayed while the detector
+// sees each sample's loudest neighbour over the lookahead window (a sliding
+// maximum kept in a monotonic deque, O(1) per sample), so gain reduction is
+// already moving when a transient arrives - no need for a very short attack.
 
 #pragma once
 
@@ -29,13 +40,30 @@ public:
     void setInputGain(float dB);       // -18 to +18 dB
     void setOutputGain(float dB);      // -18 to +18 dB
 
+    static constexpr float kMaxLookaheadMs = 10.0f;
+
+    // A lookahead change crossfades the audio from the old delay to the new
+    // one over this long. Another change arriving meanwhile waits for it.
+    static constexpr float kLookaheadFadeMs = 20.0f;
+
+    // 0 to kMaxLookaheadMs. Changes the latency - call before prepare() where
+    // possible so the host hears about it up front, otherwise between blocks.
+    void setLookahead(float ms);
+
+    // Samples the output trails the input by
+    int getLatencySamples() const { return lookaheadSamples; }
+
+    // Bypass that keeps the lookahead delay, so the latency the host was told
+    // about stays true
+    void processLatencyOnly(juce::AudioBuffer<float>& buffer);
+
     // Returns the current gain reduction in dB (always <= 0)
-    float getCurrentGainReductionDb() const { return (float)gainReductionState; }
+    float getCurrentGainReductionDb() const { return gainReductionState; }
 
     // Returns the current input envelope level in dB
     float getCurrentInputLevelDb() const
     {
-        return juce::Decibels::gainToDecibels((float)envelopeState, -100.0f);
+        return juce::Decibels::gainToDecibels(envelopeState, -100.0f);
     }
 
 private:
@@ -48,25 +76,38 @@ private:
     // -----------------------------------------------------------------------
 
     // Linked RMS envelope follower state (single detector for both channels)
-    double envelopeState = 0.0;
+    float envelopeState = 0.0f;
 
     // Smooth gain reduction state (separate smoother to avoid zipper noise
     // when the envelope changes quickly — models the optical cell's lag)
-    double gainReductionState = 0.0;
+    float gainReductionState = 0.0f;
 
     // Pre-detector low-mid emphasis filter (models optical cell sensitivity)
     // Simple single-pole shelving boost around 300-800 Hz
     juce::dsp::FirstOrderTPTFilter<float> detectorFilterL;
     juce::dsp::FirstOrderTPTFilter<float> detectorFilterR;
 
+    void processChunk(float* leftData, float* rightData, int numSamples);
+
+    // In place: delays data by the lookahead through channel's ring, fading
+    // over from the previous lookahead while a change is in progress. Then
+    // advanceLookahead() once for all channels.
+    void delayByLookahead(int channel, float* data, int numSamples);
+    void advanceLookahead(int numSamples);
+
+    // In place: each detector power becomes the maximum over the lookahead
+    // window ending at it
+    void applyLookaheadPeakHold(float* power, int numSamples);
+
     // SSL-style soft-knee gain computer
     // Returns gain reduction in dB for a given input level in dB
-    double computeGainReductionDb(double inputDb) const;
+    float computeGainReductionDb(float inputDb) const;
 
     // Program-dependent time constants (LA-2A inspired)
-    // Attack gets faster for louder signals, release gets longer for sustained
-    double computeAttackCoeff(double inputDb) const;
-    double computeReleaseCoeff(double inputDb) const;
+    // Attack gets faster for louder signals, release gets longer for
+    // sustained. Both return the one-pole weight (1 - coefficient).
+    float computeAttackWeight(float inputDb) const;
+    float computeReleaseWeight(float envelopeDb) const;
 
     // Parameters
     float thresholdDb  = -18.0f;
@@ -81,11 +122,36 @@ private:
 
     double sampleRate = 44100.0;
 
-    // Pre-computed coefficients (updated on param change)
-    double attackCoeff  = 0.0;
-    double releaseCoeff = 0.0;
+    // Nominal 1 / (time constant in samples), updated on param change
+    float attackPerSample  = 0.0f;
+    float releasePerSample = 0.0f;
 
     void updateTimeCoefficients();
 
+    // Per block, sized in prepare(): detector level, then envelope; level in
+    // dB, then gain reduction, then gain; attack weights
+    std::vector<float> levelScratch;
+    std::vector<float> levelDbScratch;
+    std::vector<float> attackScratch;
+
+    // Lookahead: audio delay per channel, and the peak-hold deque (sample
+    // number, power) - both power-of-two rings sized for kMaxLookaheadMs
+    float lookaheadMs    = 0.0f;
+    int lookaheadSamples = 0;
+    int lookaheadMask    = 0;
+    std::vector<float> lookaheadRing[2];
+    int lookaheadWritePos = 0;
+
+    // Delay being faded out after a change, and samples of the fade left
+    int lookaheadFadeFrom      = 0;
+    int lookaheadFadeRemaining = 0;
+    int lookaheadFadeLength    = 1;
+
+    std::vector<juce::int64> peakDequeIndex;
+    std::vector<float>       peakDequeValue;
+    int peakDequeHead = 0;
+    int peakDequeSize = 0;
+    juce::int64 samplesSeen = 0;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BasicCompressor)
 };
\ No newline at end of file
@@ -30,6 +30,12 @@ float BasicDelay::divisionToMs(float bpm, SyncDivision div) noexcept
     return (60000.0f / bpm) * kDivisionMultipliers[static_cast<int>(div)];
 }
 
+float BasicDelay::longestDivisionMs(float bpm) noexcept
+{
+    return (60000.0f / bpm) * *std::max_element(std::begin(kDivisionMultipliers),
+                                                std::end(kDivisionMultipliers));
+}
+
 // -----------------------------------------------------------------------------
 void BasicDelay::applyTargetDelayMs(float ms)
 {
@@ -52,6 +58,11 @@ void BasicDelay::prepare(const juce::dsp::ProcessSpec& spec)
     juce::dsp::ProcessSpec monoSpec = spec;
     monoSpec.numChannels = 1;
 
+    // One extra sample for the interpolation's older neighbour
+    const int maxDelaySamples = (int) std::ceil(maximumDelayMs * 0.001 * spec.sampleRate) + 1;
+    delayLineL.setMaximumDelayInSamples(maxDelaySamples);
+    delayLineR.setMaximumDelayInSamples(maxDelaySamples);
+
     delayLineL.prepare(monoSpec);
     delayLineR.prepare(monoSpec);
 
@@ -77,6 +88,21 @@ void BasicDelay::prepare(const juce::dsp::ProcessSpec& spec)
     highpassL.setCutoffFrequency(highpassFreqValue);
     highpassR.setCutoffFrequency(highpassFreqValue);
 
+    const auto maxBlock = (size_t) juce::jmax(1, (int) spec.maximumBlockSize);
+    headDelayScratch.assign(maxBlock, 0.0f);
+    tapIndexScratch .assign(maxBlock, 0);
+    tapScratch      .assign(maxBlock, 0.0f);
+
+    for (auto& w : tapWeightScratch)
+        w.assign(maxBlock, 0.0f);
+
+    for (auto* v : { &blockReadL, &blockReadR, &blockWriteL, &blockWriteR })
+        v->assign(maxBlock, 0.0f);
+
+    // Recomputed for the new rate
+    for (auto& tap : taps)
+        updateTapCoefficient(tap);
+
     reset();
 }
 
@@ -89,6 +115,30 @@ void BasicDelay::processBlock(juce::AudioBuffer<float>& buffer)
     float* leftChannel  = buffer.getWritePointer(0);
     float* rightChannel = numChannels > 1 ? buffer.getWritePointer(1) : nullptr;
 
+    // Chunks no longer than the scratch buffers
+    const int chunkSize = juce::jmax(1, (int) headDelayScratch.size());
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const int n = juce::jmin(chunkSize, numSamples - start);
+        processChunk(leftChannel + start, rightChannel != nullptr ? rightChannel + start : nullptr, n);
+    }
+}
+
+void BasicDelay::processChunk(float* leftChannel, float* rightChannel, int numSamples)
+{
+    if (!smoothedDelaySamples.isSmoothing())
+    {
+        const float delaySamples = juce::jlimit(1.0f, (float) (delayLineL.getNumSamples() - 1),
+                                                smoothedDelaySamples.getTargetValue());
+
+        if ((int) delaySamples > numSamples + 1)
+        {
+            processStaticChunk(leftChannel, rightChannel, numSamples, delaySamples);
+            return;
+        }
+    }
+
     const float wet      = mixAmount;
     const float dry      = 1.0f - mixAmount;
     const float fb       = feedbackAmount;
@@ -108,6 +158,7 @@ void BasicDelay::processBlock(juce::AudioBuffer<float>& buffer)
         // interpolation between adjacent buffer slots, giving us a continuously
         // moving, artefact-free read head even while BPM is being automated.
         const float delaySamples = smoothedDelaySamples.getNextValue();
+        headDelayScratch[(size_t) i] = delaySamples;
 
         // ---- Write new input into the delay buffer ---------------------------
         const float inputL = leftChannel[i];
@@ -156,6 +207,218 @@ void BasicDelay::processBlock(juce::AudioBuffer<float>& buffer)
 
     feedbackL = fbL;
     feedbackR = fbR;
+
+    if (numTaps > 0)
+        processTaps(leftChannel, rightChannel, numSamples);
+}
+
+// -----------------------------------------------------------------------------
+// Same result as processChunk() at a fixed delay of more than numSamples: the
+// head reads only what was written before this block, so the reads, the
+// feedback filters and the writes each run over the whole block in turn
+void BasicDelay::processStaticChunk(float* leftChannel, float* rightChannel, int numSamples,
+                                    float delaySamples)
+{
+    const float wet      = mixAmount;
+    const float dry      = 1.0f - mixAmount;
+    const float fb       = feedbackAmount;
+
+    const float panGainL  = 1.0f - juce::jmax(0.0f, panValue);
+    const float panGainR  = 1.0f + juce::jmin(0.0f, panValue);
+    const float phaseSign = (delayMode == DelayMode::Inverted) ? -1.0f : 1.0f;
+    const bool isStereo   = rightChannel != nullptr;
+    const bool isPingPong = (delayMode == DelayMode::PingPong) && isStereo;
+
+    std::fill(headDelayScratch.begin(), headDelayScratch.begin() + numSamples, delaySamples);
+
+    float* readL  = blockReadL.data();
+    float* readR  = blockReadR.data();
+    float* writeL = blockWriteL.data();
+    float* writeR = blockWriteR.data();
+
+    // ---- Read the whole block ------------------------------------------------
+    delayLineL.readBlock(0, delaySamples, readL, numSamples);
+    if (isStereo)
+        delayLineR.readBlock(0, delaySamples, readR, numSamples);
+
+    // ---- Feedback filters over the block -------------------------------------
+    // Sample i's write carries the filtered read of sample i - 1 - the last
+    // block's for i == 0
+    writeL[0] = feedbackL;
+    for (int i = 0; i < numSamples - 1; ++i)
+        writeL[i + 1] = highpassL.processSample(0, lowpassL.processSample(0, readL[i]));
+    const float lastL = highpassL.processSample(0, lowpassL.processSample(0, readL[numSamples - 1]));
+
+    float lastR = feedbackR;
+    if (isStereo)
+    {
+        writeR[0] = feedbackR;
+        for (int i = 0; i < numSamples - 1; ++i)
+            writeR[i + 1] = highpassR.processSample(0, lowpassR.processSample(0, readR[i]));
+        lastR = highpassR.processSample(0, lowpassR.processSample(0, readR[numSamples - 1]));
+    }
+
+    // ---- Write the block back ------------------------------------------------
+    if (isPingPong)
+    {
+        // Cross-feed: L takes R's feedback and vice versa
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float fromR = writeR[i];
+            writeR[i] = rightChannel[i] + writeL[i] * fb;
+            writeL[i] = leftChannel[i]  + fromR     * fb;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numSamples; ++i)
+            writeL[i] = leftChannel[i] + writeL[i] * fb;
+
+        if (isStereo)
+            for (int i = 0; i < numSamples; ++i)
+                writeR[i] = rightChannel[i] + writeR[i] * fb;
+    }
+
+    delayLineL.pushBlock(0, writeL, numSamples);
+    if (isStereo)
+        delayLineR.pushBlock(0, writeR, numSamples);
+
+    // ---- Output --------------------------------------------------------------
+    const float gainL = phaseSign * wet * (isStereo ? panGainL : 1.0f);
+    for (int i = 0; i < numSamples; ++i)
+        leftChannel[i] = leftChannel[i] * dry + readL[i] * gainL;
+
+    if (isStereo)
+    {
+        const float gainR = phaseSign * wet * panGainR;
+        for (int i = 0; i < numSamples; ++i)
+            rightChannel[i] = rightChannel[i] * dry + readR[i] * gainR;
+    }
+
+    feedbackL = lastL;
+    feedbackR = lastR;
+
+    if (numTaps > 0)
+        processTaps(leftChannel, rightChannel, numSamples);
+}
+
+// -----------------------------------------------------------------------------
+// Every sample of the block is in the delay lines by now, so each tap is one
+// pass of plain loads from the ring - no per-sample delay line calls. Read
+// positions and weights depend only on the delay, so both channels share them.
+void BasicDelay::processTaps(float* leftChannel, float* rightChannel, int numSamples)
+{
+    const int size      = delayLineL.getNumSamples();
+    const float wet     = mixAmount * ((delayMode == DelayMode::Inverted) ? -1.0f : 1.0f);
+    const float invN    = 1.0f / (float) numSamples;
+    const bool lagrange = interpolation != DelayInterpolation::Linear;
+
+    // Ring index of this block's first sample
+    int base = delayLineL.getWritePosition(0) - numSamples;
+    if (base < 0)
+        base += size;
+
+    // Further back than this, the block has already overwritten the oldest
+    // point read
+    const float minDelay = lagrange ? 2.0f : 1.0f;
+    const float maxDelay = (float) (size - 3 - numSamples);
+
+    int*   index    = tapIndexScratch.data();
+    float* w0       = tapWeightScratch[0].data();
+    float* w1       = tapWeightScratch[1].data();
+    float* w2       = tapWeightScratch[2].data();
+    float* w3       = tapWeightScratch[3].data();
+    float* gathered = tapScratch.data();
+
+    for (int t = 0; t < numTaps; ++t)
+    {
+        auto& tap = taps[t];
+
+        // ---- Read positions and weights, as readFractional() -----------------
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float d = juce::jlimit(minDelay, maxDelay, tap.timeRatio * headDelayScratch[(size_t) i]);
+
+            int   whole = (int) d;
+            float frac  = d - (float) whole;
+
+            if (lagrange)
+            {
+                // Fraction centred between the middle two of four points
+                --whole;
+                frac += 1.0f;
+
+                const float d1 = frac - 1.0f;
+                const float d2 = frac - 2.0f;
+                const float d3 = frac - 3.0f;
+
+                w0[i] = -d1 * d2 * d3 * (1.0f / 6.0f);
+                w1[i] =  frac * d2 * d3 * 0.5f;
+                w2[i] = -frac * d1 * d3 * 0.5f;
+                w3[i] =  frac * d1 * d2 * (1.0f / 6.0f);
+            }
+            else
+            {
+                w0[i] = 1.0f - frac;
+                w1[i] = frac;
+            }
+
+            int idx = base + i + 1 - whole;
+            if (idx < 0)          idx += size;
+            else if (idx >= size) idx -= size;
+
+            index[i] = idx;
+        }
+
+        for (int ch = 0; ch < (rightChannel != nullptr ? 2 : 1); ++ch)
+        {
+            const float* ring = (ch == 0 ? delayLineL : delayLineR).getReadPointer(0);
+
+            // ---- Gather -----------------------------------------------------
+            if (lagrange)
+            {
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const int i0 = index[i];
+                    const int i1 = i0 >= 1 ? i0 - 1 : i0 - 1 + size;
+                    const int i2 = i0 >= 2 ? i0 - 2 : i0 - 2 + size;
+                    const int i3 = i0 >= 3 ? i0 - 3 : i0 - 3 + size;
+
+                    gathered[i] = ring[i0] * w0[i] + ring[i1] * w1[i] + ring[i2] * w2[i] + ring[i3] * w3[i];
+                }
+            }
+            else
+            {
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const int i0 = index[i];
+                    const int i1 = i0 >= 1 ? i0 - 1 : size - 1;
+
+                    gathered[i] = ring[i0] * w0[i] + ring[i1] * w1[i];
+                }
+            }
+
+            // Mono output takes the tap at its level, unpanned
+            const bool mono  = rightChannel == nullptr;
+            const float from = mono ? tap.appliedGainL : (ch == 0 ? tap.appliedGainL : tap.appliedGainR);
+            const float to   = mono ? juce::jmax(tap.gainL, tap.gainR) : (ch == 0 ? tap.gainL : tap.gainR);
+            const float step = (to - from) * invN;
+
+            float* out   = ch == 0 ? leftChannel : rightChannel;
+            float& state = ch == 0 ? tap.stateL : tap.stateR;
+            const float c = tap.coefficient;
+
+            // Level and pan ramp across the block
+            for (int i = 0; i < numSamples; ++i)
+            {
+                state += c * (gathered[i] - state);
+                out[i] += state * (from + step * (float) (i + 1)) * wet;
+            }
+        }
+
+        tap.appliedGainL = rightChannel != nullptr ? tap.gainL : juce::jmax(tap.gainL, tap.gainR);
+        tap.appliedGainR = tap.gainR;
+    }
 }
 
 // -----------------------------------------------------------------------------
@@ -168,6 +431,13 @@ void BasicDelay::reset()
     lowpassL.reset();  lowpassR.reset();
     highpassL.reset(); highpassR.reset();
 
+    for (auto& tap : taps)
+    {
+        tap.stateL = tap.stateR = 0.0f;
+        tap.appliedGainL = tap.gainL;
+        tap.appliedGainR = tap.gainR;
+    }
+
     // Snap the smoother so stale ramps don't bleed into the next session
     smoothedDelaySamples.setCurrentAndTargetValue(
         smoothedDelaySamples.getTargetValue());
@@ -199,6 +469,18 @@ void BasicDelay::setCurrentBpm(float bpm)
     applyTargetDelayMs(divisionToMs(bpm, syncDivision));
 }
 
+void BasicDelay::setInterpolation(DelayInterpolation newInterpolation)
+{
+    interpolation = newInterpolation;
+    delayLineL.setInterpolation(newInterpolation);
+    delayLineR.setInterpolation(newInterpolation);
+}
+
+void BasicDelay::setMaximumDelayMs(float maxMs)
+{
+    maximumDelayMs = juce::jlimit(1.0f, kMaximumDelayCapMs, maxMs);
+}
+
 void BasicDelay::setRampTimeMs(float rampMs)
 {
     rampTimeMs = juce::jmax(1.0f, rampMs);
@@ -238,6 +520,49 @@ void BasicDelay::setLowpassFreq(float freq)
     }
 }
 
+void BasicDelay::setNumTaps(int newNumTaps)
+{
+    newNumTaps = juce::jlimit(0, kMaxTaps, newNumTaps);
+
+    // Taps coming in fade up from silence with a clean filter
+    for (int t = numTaps; t < newNumTaps; ++t)
+    {
+        taps[t].appliedGainL = taps[t].appliedGainR = 0.0f;
+        taps[t].stateL = taps[t].stateR = 0.0f;
+    }
+
+    numTaps = newNumTaps;
+}
+
+void BasicDelay::setTap(int index, float timeRatio, float level, float pan, float lowpassHz)
+{
+    if (!juce::isPositiveAndBelow(index, kMaxTaps))
+        return;
+
+    auto& tap = taps[index];
+
+    tap.timeRatio = juce::jlimit(0.01f, kMaxTapRatio, timeRatio);
+
+    level = juce::jlimit(0.0f, 1.0f, level);
+    pan   = juce::jlimit(-1.0f, 1.0f, pan);
+    tap.gainL = level * (1.0f - juce::jmax(0.0f, pan));
+    tap.gainR = level * (1.0f + juce::jmin(0.0f, pan));
+
+    lowpassHz = juce::jlimit(200.0f, 20000.0f, lowpassHz);
+
+    if (!juce::approximatelyEqual(lowpassHz, tap.lowpassHz))
+    {
+        tap.lowpassHz = lowpassHz;
+        updateTapCoefficient(tap);
+    }
+}
+
+void BasicDelay::updateTapCoefficient(Tap& tap)
+{
+    tap.coefficient = juce::jlimit(0.0f, 1.0f, 1.0f - std::exp(-juce::MathConstants<float>::twoPi
+                                                                * tap.lowpassHz / sampleRate));
+}
+
 void BasicDelay::setHighpassFreq(float freq)
 {
     float clamped = juce::jlimit(20.0f, 5000.0f, freq);
@@ -1,5 +1,15 @@
 // BasicDelay.h - Stereo delay with BPM sync, ping pong, panning, and filters
 // Uses readFractional() for smooth continuous read-head movement during tempo automation
+//
+// Multi-tap: up to kMaxTaps extra read heads on the same delay lines, each
+// with its own time, level, pan and lowpass. They only feed the output (the
+// main head alone feeds back), so they are gathered over the whole block
+// once it has been written, and cost a read and a one-pole filter per
+// sample each - not another delay line.
+//
+// While the delay time holds still and is longer than the block, nothing
+// read in a block depends on what it writes, so the block is read in one
+// copy, filtered as a vector and written back in one copy.
 
 #pragma once
 
@@ -59,13 +69,66 @@ public:
     // How long the read head glides to a new delay time (default 50ms)
     void setRampTimeMs(float rampMs);
 
+    // Read-head interpolation. Taps read with Lagrange3 whenever it is not
+    // Linear - Thiran's allpass state belongs to the one head per line.
+    void setInterpolation(DelayInterpolation newInterpolation);
+
+    // Longest delay the lines must hold, applied at the next prepare() and
+    // capped at kMaximumDelayCapMs. Longer delays are clamped; taps beyond it
+    // read the oldest sample kept.
+    void setMaximumDelayMs(float maxMs);
+
+    // What the lines hold until told otherwise (the old fixed size, at 48 kHz)
+    static constexpr float kDefaultMaximumDelayMs = 4000.0f;
+
+    // Most the lines will ever hold: a whole note at 20 BPM. Two lines of it
+    // are about 4.2 MB at 44.1 kHz and 18 MB at 192 kHz; taps reaching past
+    // the head at that tempo are clamped rather than sized for.
+    static constexpr float kMaximumDelayCapMs = 12000.0f;
+
+    // Longest synced delay at the given tempo, over all divisions
+    static float longestDivisionMs(float bpm) noexcept;
+
+    static constexpr int kMaxTaps = 8;
+
+    // Longest tap, as a multiple of the delay time
+    static constexpr float kMaxTapRatio = 2.0f;
+
+    // Number of extra read heads, 0 (single head) to kMaxTaps
+    void setNumTaps(int newNumTaps);
+
+    // timeRatio is a multiple of the delay time, so taps follow BPM sync and
+    // glide with the main head. level is linear; pan as setPan().
+    void setTap(int index, float timeRatio, float level, float pan, float lowpassHz);
+
 private:
+    struct Tap
+    {
+        float timeRatio   = 1.0f;
+        float gainL       = 0.0f;   // level and pan
+        float gainR       = 0.0f;
+        float lowpassHz   = 20000.0f;
+        float coefficient = 1.0f;   // one-pole lowpass
+
+        // Audio thread: gains the last block ended on, filter state
+        float appliedGainL = 0.0f;
+        float appliedGainR = 0.0f;
+        float stateL       = 0.0f;
+        float stateR       = 0.0f;
+    };
+
+    void processChunk(float* leftChannel, float* rightChannel, int numSamples);
+    void processStaticChunk(float* leftChannel, float* rightChannel, int numSamples, float delaySamples);
+    void processTaps(float* leftChannel, float* rightChannel, int numSamples);
+    void updateTapCoefficient(Tap& tap);
+
     static float divisionToMs(float bpm, SyncDivision div) noexcept;
     void applyTargetDelayMs(float ms);
 
-    // ~4 sec buffer at 48k -- enough headroom for slow BPM subdivisions
-    DelayLineWithSampleAccess<float> delayLineL { 192001 };
-    DelayLineWithSampleAccess<float> delayLineR { 192001 };
+    // Sized in prepare() from maximumDelayMs and the sample rate
+    DelayLineWithSampleAccess<float> delayLineL;
+    DelayLineWithSampleAccess<float> delayLineR;
+    float maximumDelayMs = kDefaultMaximumDelayMs;
 
     float sampleRate = 44100.0f;
 
@@ -92,5 +155,21 @@ private:
     juce::dsp::FirstOrderTPTFilter<float> lowpassL,  lowpassR;
     juce::dsp::FirstOrderTPTFilter<float> highpassL, highpassR;
 
+    Tap taps[kMaxTaps];
+    int numTaps = 0;
+
+    DelayInterpolation interpolation = DelayInterpolation::Linear;
+
+    // Per block, sized in prepare(): the main head's delay at every sample,
+    // and one tap's read positions, interpolation weights and output
+    std::vector<float> headDelayScratch;
+    std::vector<int>   tapIndexScratch;
+    std::vector<float> tapWeightScratch[4];
+    std::vector<float> tapScratch;
+
+    // Static block path: what the head reads, and what goes back into the lines
+    std::vector<float> blockReadL, blockReadR;
+    std::vector<float> blockWriteL, blockWriteR;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BasicDelay)
 };
\ No newline at end of file
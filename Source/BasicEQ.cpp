@@ -1,4 +1,53 @@
 #include "BasicEQ.h"
+#include <thread>
+
+namespace
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    // The fused cascade, TDF-II per section. Coefficients are broadcast to
+    // every lane; when ramping they step by delta after each frame.
+    template <int numSections, bool ramping>
+    void runCascade(Vec* frames, int numFrames,
+                    Vec (&coeffs)[numSections][5], const Vec (&delta)[numSections][5],
+                    Vec (&stage1)[numSections], Vec (&stage2)[numSections])
+    {
+        // Local copies stay in registers - frames could alias the members
+        Vec s1[numSections], s2[numSections];
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            s1[s] = stage1[s];
+            s2[s] = stage2[s];
+        }
+
+        for (int n = 0; n < numFrames; ++n)
+        {
+            Vec x = frames[n];
+
+            for (int s = 0; s < numSections; ++s)
+            {
+                const Vec y = coeffs[s][0] * x + s1[s];
+                s1[s] = coeffs[s][1] * x - coeffs[s][3] * y + s2[s];
+                s2[s] = coeffs[s][2] * x - coeffs[s][4] * y;
+                x = y;
+            }
+
+            frames[n] = x;
+
+            if constexpr (ramping)
+                for (int s = 0; s < numSections; ++s)
+                    for (int k = 0; k < 5; ++k)
+                        coeffs[s][k] += delta[s][k];
+        }
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            stage1[s] = s1[s];
+            stage2[s] = s2[s];
+        }
+    }
+}
 
 BasicEQ::BasicEQ() {}
 BasicEQ::~BasicEQ() {}
@@ -7,32 +56,94 @@ void BasicEQ::prepare(const juce::dsp::ProcessSpec& spec)
 {
     sampleRate = spec.sampleRate;
 
-    lowShelf.prepare(spec);
-    midPeak.prepare(spec);
-    highShelf.prepare(spec);
+    frames.assign((size_t) juce::jmax(1, (int) spec.maximumBlockSize), Vec::expand(0.0f));
 
     updateLowCoeffs();
     updateMidCoeffs();
     updateHighCoeffs();
 
+    // Nothing to ramp from yet
+    for (int s = 0; s < kNumSections; ++s)
+        currentCoeffs[s] = targetCoeffs[s];
+
     reset();
 }
 
 void BasicEQ::processBlock(juce::AudioBuffer<float>& buffer)
 {
-    juce::dsp::AudioBlock<float> block(buffer);
-    juce::dsp::ProcessContextReplacing<float> ctx(block);
+    constexpr int stride = (int) Vec::SIMDNumElements;
+
+    const int numChannels = juce::jmin(buffer.getNumChannels(), stride);
+    const int numSamples  = buffer.getNumSamples();
+    const int chunkSize   = (int) frames.size();
+
+    if (numChannels == 0 || chunkSize == 0)
+        return;
 
-    lowShelf.process(ctx);
-    midPeak.process(ctx);
-    highShelf.process(ctx);
+    auto* lanes = reinterpret_cast<float*>(frames.data());
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const int n = juce::jmin(chunkSize, numSamples - start);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* in = buffer.getReadPointer(ch, start);
+
+            for (int i = 0; i < n; ++i)
+                lanes[i * stride + ch] = in[i];
+        }
+
+        processFrames(n);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* out = buffer.getWritePointer(ch, start);
+
+            for (int i = 0; i < n; ++i)
+                out[i] = lanes[i * stride + ch];
+        }
+    }
+}
+
+void BasicEQ::processFrames(int numFrames)
+{
+    Vec coeffs[kNumSections][5];
+    Vec delta[kNumSections][5];
+    bool ramping = false;
+
+    for (int s = 0; s < kNumSections; ++s)
+    {
+        ramping = ramping || currentCoeffs[s] != targetCoeffs[s];
+
+        for (int k = 0; k < 5; ++k)
+        {
+            coeffs[s][k] = Vec::expand(currentCoeffs[s][k]);
+            delta[s][k]  = Vec::expand((targetCoeffs[s][k] - currentCoeffs[s][k]) / (float) numFrames);
+        }
+    }
+
+    if (ramping)
+    {
+        runCascade<kNumSections, true>(frames.data(), numFrames, coeffs, delta, stage1, stage2);
+
+        // Land exactly, rather than wherever the steps summed to
+        for (int s = 0; s < kNumSections; ++s)
+            currentCoeffs[s] = targetCoeffs[s];
+    }
+    else
+    {
+        runCascade<kNumSections, false>(frames.data(), numFrames, coeffs, delta, stage1, stage2);
+    }
 }
 
 void BasicEQ::reset()
 {
-    lowShelf.reset();
-    midPeak.reset();
-    highShelf.reset();
+    for (int s = 0; s < kNumSections; ++s)
+    {
+        stage1[s] = Vec::expand(0.0f);
+        stage2[s] = Vec::expand(0.0f);
+    }
 }
 
 // -------------------------------------------------------------------------
@@ -105,32 +216,98 @@ void BasicEQ::setHighQ(float q)
 // Coefficient helpers
 // -------------------------------------------------------------------------
 
+void BasicEQ::setSectionCoeffs(int section, const std::array<float, 6>& raw)
+{
+    // raw is b0, b1, b2, a0, a1, a2
+    const float a0Inverse = 1.0f / raw[3];
+
+    // Seqlock write: the version is odd while the coefficients are changing,
+    // so the display can tell its copy was torn and take it again
+    responseVersion.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    targetCoeffs[section] = { raw[0] * a0Inverse, raw[1] * a0Inverse, raw[2] * a0Inverse,
+                              raw[4] * a0Inverse, raw[5] * a0Inverse };
+
+    responseVersion.fetch_add(1, std::memory_order_release);
+}
+
+void BasicEQ::copyTargetCoeffs(SectionCoeffs (&coeffs)[kNumSections]) const
+{
+    // Seqlock read - the audio thread never waits, the display retries until
+    // it gets a copy no write overlapped
+    for (;;)
+    {
+        const int before = responseVersion.load(std::memory_order_acquire);
+
+        if ((before & 1) == 0)
+        {
+            std::copy(std::begin(targetCoeffs), std::end(targetCoeffs), std::begin(coeffs));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (responseVersion.load(std::memory_order_relaxed) == before)
+                return;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
 void BasicEQ::updateLowCoeffs()
 {
     if (sampleRate <= 0.0) return;
-    *lowShelf.state = *juce::dsp::IIR::Coefficients<float>::makeLowShelf(
-        sampleRate, lowFreq, lowQ, juce::Decibels::decibelsToGain(lowGain));
+    setSectionCoeffs(lowShelf, juce::dsp::IIR::ArrayCoefficients<float>::makeLowShelf(
+        sampleRate, lowFreq, lowQ, juce::Decibels::decibelsToGain(lowGain)));
 }
 
 void BasicEQ::updateMidCoeffs()
 {
     if (sampleRate <= 0.0) return;
-    *midPeak.state = *juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-        sampleRate, midFreq, midQ, juce::Decibels::decibelsToGain(midGain));
+    setSectionCoeffs(midPeak, juce::dsp::IIR::ArrayCoefficients<float>::makePeakFilter(
+        sampleRate, midFreq, midQ, juce::Decibels::decibelsToGain(midGain)));
 }
 
 void BasicEQ::updateHighCoeffs()
 {
     if (sampleRate <= 0.0) return;
-    *highShelf.state = *juce::dsp::IIR::Coefficients<float>::makeHighShelf(
-        sampleRate, highFreq, highQ, juce::Decibels::decibelsToGain(highGain));
+    setSectionCoeffs(highShelf, juce::dsp::IIR::ArrayCoefficients<float>::makeHighShelf(
+        sampleRate, highFreq, highQ, juce::Decibels::decibelsToGain(highGain)));
 }
 
 float BasicEQ::getMagnitudeForFrequency(float freq)
 {
-    auto low = lowShelf.state->getMagnitudeForFrequency(freq, sampleRate);
-    auto mid = midPeak.state->getMagnitudeForFrequency(freq, sampleRate);
-    auto high = highShelf.state->getMagnitudeForFrequency(freq, sampleRate);
+    SectionCoeffs coeffs[kNumSections];
+    copyTargetCoeffs(coeffs);
+
+    return magnitudeOf(coeffs, freq, sampleRate);
+}
+
+void BasicEQ::getMagnitudesForFrequencies(const float* freqs, float* magnitudes, int num)
+{
+    // One snapshot for the whole curve
+    SectionCoeffs coeffs[kNumSections];
+    copyTargetCoeffs(coeffs);
+
+    for (int i = 0; i < num; ++i)
+        magnitudes[i] = magnitudeOf(coeffs, freqs[i], sampleRate);
+}
+
+float BasicEQ::magnitudeOf(const SectionCoeffs (&coeffs)[kNumSections], float freq, double rate)
+{
+    // |H(e^jw)| of each section, multiplied through the cascade
+    const double w = juce::MathConstants<double>::twoPi * freq / rate;
+    const std::complex<double> z1 = std::polar(1.0, -w);   // z^-1
+    const std::complex<double> z2 = z1 * z1;
+
+    double magnitude = 1.0;
+
+    for (const auto& c : coeffs)
+    {
+        const auto numerator   = (double) c[0] + (double) c[1] * z1 + (double) c[2] * z2;
+        const auto denominator = 1.0 + (double) c[3] * z1 + (double) c[4] * z2;
+
+        magnitude *= std::abs(numerator) / std::abs(denominator);
+    }
 
-    return low * mid * high;
+    return (float) magnitude;
 }
\ No newline at end of file
@@ -1,4 +1,9 @@
 // BasicEQ.h - 3-Band Parametric EQ (Low Shelf, Mid Peak, High Shelf)
+//
+// The three biquads run as one fused cascade: a single pass over the block
+// with the channels side by side in SIMD lanes (L in lane 0, R in lane 1).
+// Coefficient changes don't jump - each block ramps linearly from the last
+// block's coefficients to the new ones, so automation doesn't click.
 
 #pragma once
 
@@ -34,17 +39,49 @@ public:
     void setHighGain(float gainDb);    // dB
     void setHighQ(float q);            // Q factor
 
+    // Response of the coefficients being ramped to
     float getMagnitudeForFrequency(float freq);
+    void getMagnitudesForFrequencies(const float* freqs, float* magnitudes, int num);
+
+    // Bumped whenever the target response changes - the display redraws its
+    // curve only then
+    int getResponseVersion() const { return responseVersion.load(std::memory_order_acquire); }
+
     double sampleRate = 44100.0;
 
 private:
-    // Each band is a stereo IIR filter chain (L + R processed separately via ProcessorDuplicator)
-    using MonoFilter = juce::dsp::IIR::Filter<float>;
-    using StereoFilter = juce::dsp::ProcessorDuplicator<MonoFilter, juce::dsp::IIR::Coefficients<float>>;
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    // One normalised biquad section (a0 == 1): b0, b1, b2, a1, a2
+    using SectionCoeffs = std::array<float, 5>;
+
+    enum Section { lowShelf, midPeak, highShelf };
+    static constexpr int kNumSections = 3;
+
+    // Where each section is heading (written by the setters) and where the
+    // kernel is now; processBlock ramps current to target across the block.
+    // Both start as pass-through.
+    SectionCoeffs targetCoeffs[kNumSections]  { { 1.0f }, { 1.0f }, { 1.0f } };
+    SectionCoeffs currentCoeffs[kNumSections] { { 1.0f }, { 1.0f }, { 1.0f } };
+
+    // Seqlock over targetCoeffs: odd while setSectionCoeffs is writing
+    std::atomic<int> responseVersion { 0 };
+
+    void copyTargetCoeffs(SectionCoeffs (&coeffs)[kNumSections]) const;
 
-    StereoFilter lowShelf;
-    StereoFilter midPeak;
-    StereoFilter highShelf;
+    static float magnitudeOf(const SectionCoeffs (&coeffs)[kNumSections], float freq, double rate);
+
+    // Transposed direct form II state, one channel per lane
+    Vec stage1[kNumSections];
+    Vec stage2[kNumSections];
+
+    // One frame (a sample of every channel) per register, sized in prepare().
+    // Channels beyond Vec::size() pass through untouched.
+    std::vector<Vec> frames;
+
+    void processFrames(int numFrames);
+
+    void setSectionCoeffs(int section, const std::array<float, 6>& raw);
 
     // Parameter cache
     float lowFreq  = 200.0f;
@@ -59,8 +96,6 @@ private:
     float highGain = 0.0f;
     float highQ    = 0.707f;
 
-
-
     void updateLowCoeffs();
     void updateMidCoeffs();
     void updateHighCoeffs();
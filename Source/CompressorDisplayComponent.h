@@ -34,7 +34,7 @@ class CompressorDisplayComponent : public juce::Component,
 public:
     explicit CompressorDisplayComponent(CompressorModule& modRef);
 
-    // Called by CompressorModuleSlotEditor's timer when meterReady is true
+    // Called by CompressorModuleSlotEditor with each slot meter reading
     void pushMeterValues(float inputDb, float grDb);
 
     void paint(juce::Graphics&) override;
@@ -16,6 +16,8 @@ CompressorModule::CompressorModule(const juce::String& id, juce::AudioProcessorV
 
 void CompressorModule::prepare(const juce::dsp::ProcessSpec& spec)
 {
+    // Lookahead before prepare, so the latency is right from the start
+    compressor.setLookahead(state.getRawParameterValue(moduleID + ".compLookahead")->load());
     compressor.prepare(spec);
 }
 
@@ -30,11 +32,15 @@ void CompressorModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffe
 
     if (*state.getRawParameterValue(moduleID + ".enabled") > 0.5f)
         compressor.processBlock(buffer);
+    else
+        compressor.processLatencyOnly(buffer);
+}
 
-    // Push meter values for the UI to poll - same pattern as EQModule::fftReady
-    inputLevelDb.store  (compressor.getCurrentInputLevelDb(),   std::memory_order_relaxed);
-    gainReductionDb.store(compressor.getCurrentGainReductionDb(), std::memory_order_relaxed);
-    meterReady.store(true, std::memory_order_release);
+bool CompressorModule::getGainReduction(float& reductionDb, float& detectorDb) const
+{
+    reductionDb = compressor.getCurrentGainReductionDb();
+    detectorDb  = compressor.getCurrentInputLevelDb();
+    return true;
 }
 
 float CompressorModule::getThresholdDb() const
@@ -50,10 +56,23 @@ std::vector<juce::String> CompressorModule::getUsedParameters() const
         "compAttack",
         "compRelease",
         "compInput",
-        "compOutput"
+        "compOutput",
+        "compLookahead"
     };
 }
 
+int CompressorModule::getLatencySamples() const
+{
+    return compressor.getLatencySamples();
+}
+
+void CompressorModule::updateLatency()
+{
+    // Only here, never mid-block - the processor has already lined the
+    // chains up for the latency it read after this
+    compressor.setLookahead(state.getRawParameterValue(moduleID + ".compLookahead")->load());
+}
+
 void CompressorModule::setID(juce::String& newID) { moduleID = newID; }
 
 juce::String CompressorModule::getID()   const { return moduleID; }
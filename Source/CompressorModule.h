@@ -25,14 +25,11 @@ public:
     void setID(juce::String& newID) override;
     juce::String getType() const override;
 
-    // -----------------------------------------------------------------------
-    // Meter data - written by audio thread, read by UI thread (same pattern
-    // as EQModule::fftReady / fftBuffer).
-    // meterReady is set to true each process block so the editor can poll.
-    // -----------------------------------------------------------------------
-    std::atomic<float> inputLevelDb  { -100.0f };
-    std::atomic<float> gainReductionDb { 0.0f };
-    std::atomic<bool>  meterReady    { false };
+    int getLatencySamples() const override;
+    void updateLatency() override;
+
+    // Gain reduction and the detector's level, for the slot's ModuleMeter
+    bool getGainReduction(float& reductionDb, float& detectorDb) const override;
 
     // Expose threshold so the display can draw the threshold line
     float getThresholdDb() const;
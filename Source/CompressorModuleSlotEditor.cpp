@@ -17,7 +17,6 @@ CompressorModuleSlotEditor::CompressorModuleSlotEditor(
     : BaseModuleSlotEditor(cIndex, sIndex, info, p, apvtsRef)
 {
     buildEditor(info);
-    startTimerHz(60);
 }
 
 // ---------------------------------------------------------------------------
@@ -44,6 +43,14 @@ void CompressorModuleSlotEditor::buildEditor(const SlotInfo& info)
 
     display = std::make_unique<CompressorDisplayComponent>(*mod);
     addAndMakeVisible(*display);
+
+    // The slot meter is the one reader of the meter ring; the display gets
+    // its gain reduction from there
+    slotMeter.onReading = [this](const ModuleMeter::Reading& reading)
+    {
+        if (reading.hasGainReduction)
+            display->pushMeterValues(reading.detectorDb, reading.gainReductionDb);
+    };
 }
 
 // ---------------------------------------------------------------------------
@@ -79,20 +86,6 @@ void CompressorModuleSlotEditor::layoutEditor(juce::Rectangle<int>& r)
     }
 }
 
-// ---------------------------------------------------------------------------
-// Timer - poll meterReady, push values to display (same as EQModuleSlotEditor)
-// ---------------------------------------------------------------------------
-
-void CompressorModuleSlotEditor::timerCallback()
-{
-    if (mod && mod->meterReady.exchange(false, std::memory_order_acquire))
-    {
-        display->pushMeterValues(
-            mod->inputLevelDb.load(std::memory_order_relaxed),
-            mod->gainReductionDb.load(std::memory_order_relaxed));
-    }
-}
-
 // ---------------------------------------------------------------------------
 // Parameter control helpers (identical to EQModuleSlotEditor)
 // ---------------------------------------------------------------------------
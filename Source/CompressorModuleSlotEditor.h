@@ -5,7 +5,7 @@
     Slot editor for the compressor module.  Mirrors EQModuleSlotEditor:
     - Builds rotary sliders from APVTS parameters
     - Owns a CompressorDisplayComponent
-    - Timer polls CompressorModule::meterReady and pushes values to the display
+    - Forwards the slot meter's gain reduction readings to the display
 
   ==============================================================================
 */
@@ -16,8 +16,7 @@
 #include "CompressorModule.h"
 #include "CompressorDisplayComponent.h"
 
-class CompressorModuleSlotEditor : public BaseModuleSlotEditor,
-                                   private juce::Timer
+class CompressorModuleSlotEditor : public BaseModuleSlotEditor
 {
 public:
     CompressorModuleSlotEditor(
@@ -58,7 +57,5 @@ private:
     CompressorModule*                        mod     = nullptr;
     std::unique_ptr<CompressorDisplayComponent> display;
 
-    void timerCallback() override;
-
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompressorModuleSlotEditor)
 };
\ No newline at end of file
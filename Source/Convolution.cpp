@@ -1,29 +1,96 @@
 #include "Convolution.h"
 #include "IRBank.h"
 
-Convolution::Convolution() {}
-Convolution::~Convolution() {}
+//==============================================================================
+// IRLoadThread
+//==============================================================================
+
+IRLoadThread::IRLoadThread()
+    : juce::Thread("Convolution IR Loader")
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+IRLoadThread::~IRLoadThread()
+{
+    stopThread(4000);
+}
+
+void IRLoadThread::addClient(Convolution* client)
+{
+    const juce::ScopedLock sl(lock);
+    clients.addIfNotAlreadyThere(client);
+}
+
+void IRLoadThread::removeClient(Convolution* client)
+{
+    const juce::ScopedLock sl(lock);
+    clients.removeFirstMatchingValue(client);
+}
+
+void IRLoadThread::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+
+        const juce::ScopedLock sl(lock);
+
+        for (auto* client : clients)
+        {
+            if (threadShouldExit())
+                return;
+
+            client->serviceLoadRequest();
+        }
+    }
+}
+
+//==============================================================================
+// Convolution
+//==============================================================================
+
+Convolution::Convolution()
+{
+    loader->addClient(this);
+}
+
+Convolution::~Convolution()
+{
+    if (irBank)
+        irBank->removeListener(this);
+
+    // Waits for a load in progress on this instance to finish
+    loader->removeClient(this);
+}
 
 void Convolution::prepare(const juce::dsp::ProcessSpec& spec)
 {
+    const juce::ScopedLock sl(loader->getLock());
+
     currentSampleRate = spec.sampleRate;
     prepared = true;
 
     reset();
 
+    // Re-partition for the new rate first so prepare() starts on the new
+    // kernel, shifted by the pre-delay in samples at the new rate
+    rebuildKernel();
+    updatePreDelay();
+    convolver.setMidInput(requestedMidInput.load(std::memory_order_relaxed));
     convolver.prepare(spec);
 
-    preDelayL.prepare(spec);
-    preDelayR.prepare(spec);
-
-    const int maxPreDelaySamples = (int)(spec.sampleRate * 2.0);
-    preDelayL.setMaximumDelayInSamples(maxPreDelaySamples);
-    preDelayR.setMaximumDelayInSamples(maxPreDelaySamples);
-
-    updatePreDelay();
+    // Longest input delay a design can ask for: the early part plus the
+    // full pre-delay range
+    lateTail.prepare(spec, (int)((kMaxEarlyMs + 200.0f) * 0.001 * spec.sampleRate));
+    tailInputBuffer .setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+    tailOutputBuffer.setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+    tailSounding = false;
 
     lowCut.prepare(spec);
     highCut.prepare(spec);
+    tailLowCut.prepare(spec);
+    tailHighCut.prepare(spec);
 
     // Invalidate cached freqs so updateFilters runs fully on first call
     lastLowCutHz  = -1.0f;
@@ -36,33 +103,49 @@ void Convolution::prepare(const juce::dsp::ProcessSpec& spec)
     smoothedIRGain.reset(spec.sampleRate, 0.05);
     smoothedIRGain.setCurrentAndTargetValue(
         juce::Decibels::decibelsToGain(parameters.irGainDb));
+
+    smoothedTailGain.reset(spec.sampleRate, 0.05);
+    smoothedTailGain.setCurrentAndTargetValue(smoothedIRGain.getTargetValue());
+
+    // Bake whatever tone the first blocks bring in once it has settled
+    toneSettleSamples = (int)(kToneSettleSeconds * spec.sampleRate);
+
+    bypassDryBuffer.setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+    bypassMix.reset(spec.sampleRate, PartitionedConvolver::kCrossfadeSeconds);
+    bypassMix.setCurrentAndTargetValue(isBypassIR() ? 1.0f : 0.0f);
+    engineIdle = false;
 }
 
 void Convolution::reset()
 {
     convolver.reset();
-    preDelayL.reset();
-    preDelayR.reset();
     lowCut.reset();
     highCut.reset();
+    lateTail.reset();
+    tailLowCut.reset();
+    tailHighCut.reset();
     dryWetMixer.reset();
 }
 
+// Pre-delay is leading silence on the IR - the engine shifts its partition
+// schedule by it instead of running a delay line
 void Convolution::updatePreDelay()
 {
-    if (!prepared)
-        return;
+    appliedPreDelayMs = requestedPreDelayMs.load(std::memory_order_relaxed);
+    convolver.setPreDelay(juce::roundToInt(appliedPreDelayMs * 0.001 * currentSampleRate));
+    pushTailDesign();
+}
 
-    float newDelay = parameters.preDelay * 0.001f * (float)currentSampleRate;
-    newDelay = juce::jlimit(0.0f, (float)preDelayL.getMaximumDelayInSamples(), newDelay);
+// The FDN's input delay is counted from the start of the IR, so it moves
+// with the pre-delay as well
+void Convolution::pushTailDesign()
+{
+    auto design = tailEngaged ? tailDesign : FDNLateTail::Design();
 
-    if (std::abs(newDelay - preDelaySamples) > 0.01f)
-    {
-        preDelaySamples   = newDelay;
-        preDelayL.setDelay(preDelaySamples);
-        preDelayR.setDelay(preDelaySamples);
-        isPreDelayActive  = (preDelaySamples > 0.1f);
-    }
+    if (design.active)
+        design.inputDelay += convolver.getPreDelay();
+
+    lateTail.setDesign(design);
 }
 
 void Convolution::updateFilters()
@@ -70,9 +153,10 @@ void Convolution::updateFilters()
     if (!prepared)
         return;
 
-    const float sr     = (float)currentSampleRate;
-    const float lowHz  = juce::jlimit(10.0f, sr * 0.45f, parameters.lowCutHz);
-    const float highHz = juce::jlimit(lowHz + 10.0f, sr * 0.49f, parameters.highCutHz);
+    const float sr = (float)currentSampleRate;
+    float lowHz    = parameters.lowCutHz;
+    float highHz   = parameters.highCutHz;
+    clampToneFrequencies(sr, lowHz, highHz);
 
     // Early-out: nothing changed since last call
     if (lowHz == lastLowCutHz && highHz == lastHighCutHz)
@@ -85,6 +169,15 @@ void Convolution::updateFilters()
     // pointing to newly heap-allocated ones - no allocation on the audio thread
     *lowCut.state  = *juce::dsp::IIR::Coefficients<float>::makeHighPass(sr, lowHz,  1.0f);
     *highCut.state = *juce::dsp::IIR::Coefficients<float>::makeLowPass (sr, highHz, 1.0f);
+
+    *tailLowCut.state  = *lowCut.state;
+    *tailHighCut.state = *highCut.state;
+}
+
+void Convolution::clampToneFrequencies(float sampleRate, float& lowHz, float& highHz)
+{
+    lowHz  = juce::jlimit(10.0f, sampleRate * 0.45f, lowHz);
+    highHz = juce::jlimit(lowHz + 10.0f, sampleRate * 0.49f, highHz);
 }
 
 ConvolutionParameters& Convolution::getParameters()
@@ -100,25 +193,122 @@ void Convolution::setParameters(const ConvolutionParameters& newParams)
     bool filtersChanged  = std::abs(newParams.lowCutHz  - parameters.lowCutHz)  > 1.0f
                         || std::abs(newParams.highCutHz - parameters.highCutHz) > 1.0f;
     bool irChanged       = (newParams.irIndex != oldIRIndex);
+    bool lengthChanged   = std::abs(newParams.irLengthSec - parameters.irLengthSec) > 0.005f;
+    bool gainChanged     = std::abs(newParams.irGainDb - parameters.irGainDb) > 0.01f;
+    bool bakeChanged     = newParams.bakeTone != parameters.bakeTone;
 
     // Guard mix: only call setWetMixProportion when value actually changes
     if (std::abs(newParams.mix - parameters.mix) > 0.001f)
         dryWetMixer.setWetMixProportion(newParams.mix);
 
     // Guard IR gain: decibelsToGain (std::pow) only runs when value changes
-    if (std::abs(newParams.irGainDb - parameters.irGainDb) > 0.01f)
-        smoothedIRGain.setTargetValue(juce::Decibels::decibelsToGain(newParams.irGainDb));
+    if (gainChanged)
+    {
+        smoothedIRGain  .setTargetValue(juce::Decibels::decibelsToGain(newParams.irGainDb));
+        smoothedTailGain.setTargetValue(smoothedIRGain.getTargetValue());
+    }
 
     parameters = newParams;
 
     if (preDelayChanged)
-        updatePreDelay();
+    {
+        requestedPreDelayMs.store(newParams.preDelay, std::memory_order_relaxed);
+        loader->wake();
+    }
+
+    if (newParams.midInput != requestedMidInput.load(std::memory_order_relaxed))
+    {
+        requestedMidInput.store(newParams.midInput, std::memory_order_relaxed);
+        loader->wake();
+    }
+
+    if (newParams.hybridTail != requestedHybridTail.load(std::memory_order_relaxed)
+        || (newParams.hybridTail && std::abs(newParams.earlyMs - requestedEarlyMs.load(std::memory_order_relaxed)) > 0.5f))
+    {
+        requestedHybridTail.store(newParams.hybridTail, std::memory_order_relaxed);
+        requestedEarlyMs   .store(newParams.earlyMs,    std::memory_order_relaxed);
+        loader->wake();
+    }
 
     if (filtersChanged)
         updateFilters();
 
-    if (irChanged && !customIRActive)
-        loadIRAtIndex(newParams.irIndex);
+    // Only record the request here - decoding and partitioning happen on the
+    // loader thread, and the engine crossfades to the result
+    if (irChanged)
+    {
+        requestedIRIndex.store(newParams.irIndex, std::memory_order_relaxed);
+
+        if (!customIRActive.load(std::memory_order_relaxed))
+            loader->wake();
+    }
+
+    if (lengthChanged)
+    {
+        requestedIRLength.store(newParams.irLengthSec, std::memory_order_relaxed);
+        loader->wake();
+    }
+
+    // A tone control moved - back to the unbaked kernel and the live filters
+    // straight away, and start waiting for it to settle again
+    if (filtersChanged || gainChanged || bakeChanged)
+    {
+        if (requestedToneBake.exchange(false, std::memory_order_release))
+            loader->wake();
+
+        toneSettleSamples = (int)(kToneSettleSeconds * currentSampleRate);
+    }
+}
+
+void Convolution::requestToneBake()
+{
+    requestedLowCutHz .store(parameters.lowCutHz,  std::memory_order_relaxed);
+    requestedHighCutHz.store(parameters.highCutHz, std::memory_order_relaxed);
+    requestedIRGainDb .store(parameters.irGainDb,  std::memory_order_relaxed);
+    requestedToneBake .store(true, std::memory_order_release);
+    loader->wake();
+}
+
+void Convolution::irListChanged()
+{
+    // No locks here - the bank calls this with its listener lock held
+    irBankChanged.store(true, std::memory_order_relaxed);
+    loader->wake();
+}
+
+void Convolution::serviceLoadRequest()
+{
+    // Before any new kernel below, which then starts at the new offset
+    if (requestedPreDelayMs.load(std::memory_order_relaxed) != appliedPreDelayMs)
+        updatePreDelay();
+
+    convolver.setMidInput(requestedMidInput.load(std::memory_order_relaxed));
+
+    const int index = requestedIRIndex.load(std::memory_order_relaxed);
+
+    // Indices refer to the new list; Bypass is index 0 in every list
+    if (irBankChanged.exchange(false, std::memory_order_relaxed) && currentIRIndex != 0)
+        currentIRIndex = -1;
+
+    // A new IR is built at the requested length anyway
+    if (!customIRActive.load(std::memory_order_relaxed) && index != currentIRIndex)
+    {
+        loadIRAtIndex(index);
+        return;
+    }
+
+    const bool bake = requestedToneBake.load(std::memory_order_acquire);
+
+    const bool toneStale = bake != kernelToneBaked
+                        || (bake && (requestedLowCutHz .load(std::memory_order_relaxed) != bakedLowCutHz
+                                  || requestedHighCutHz.load(std::memory_order_relaxed) != bakedHighCutHz
+                                  || requestedIRGainDb .load(std::memory_order_relaxed) != bakedIRGainDb));
+
+    const bool hybridStale = requestedHybridTail.load(std::memory_order_relaxed) != kernelHybridTail
+                          || requestedEarlyMs   .load(std::memory_order_relaxed) != kernelEarlyMs;
+
+    if (toneStale || hybridStale || requestedIRLength.load(std::memory_order_relaxed) != kernelIRLength)
+        rebuildKernel();
 }
 
 void Convolution::processBlock(juce::AudioBuffer<float>& buffer,
@@ -130,53 +320,154 @@ void Convolution::processBlock(juce::AudioBuffer<float>& buffer,
         return;
 
     const int numSamples  = buffer.getNumSamples();
-    const int numChannels = buffer.getNumChannels();
+    const int numChannels = juce::jmin(buffer.getNumChannels(), bypassDryBuffer.getNumChannels());
+
+    // Follows the kernels the loader hands over rather than the parameter, so
+    // the fade starts with the engine's own crossfade - the old IR plays on
+    // until the new kernel is swapped in
+    const bool bypass = isBypassIR();
+
+    if (!convolver.isKernelPending())
+        bypassMix.setTargetValue(bypass ? 1.0f : 0.0f);
+
+    // Bypass: the input passes untouched and nothing else runs. The engine has
+    // no latency, so the signal lines up the same on either path. A kernel
+    // handed over meanwhile still needs process() to pick it up.
+    if (bypassMix.getCurrentValue() == 1.0f && !bypassMix.isSmoothing()
+        && !convolver.isCrossfading() && !convolver.isKernelPending())
+    {
+        engineIdle = true;
+        return;
+    }
+
+    if (engineIdle)
+    {
+        // Back from Bypass - nothing heard before it may ring out now
+        convolver.clearHistory();
+        lowCut.reset();
+        highCut.reset();
+        lateTail.reset();
+        tailLowCut.reset();
+        tailHighCut.reset();
+        engineIdle = false;
+    }
+
+    const bool bypassFading = bypassMix.isSmoothing() || bypassMix.getCurrentValue() > 0.0f;
+
+    if (bypassFading)
+        for (int ch = 0; ch < numChannels; ++ch)
+            bypassDryBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
 
     // Push dry samples before any wet processing
     dryWetMixer.pushDrySamples(juce::dsp::AudioBlock<float>(buffer));
 
-    // 1) Pre-delay - skipped entirely when inactive
-    if (isPreDelayActive)
+    // Kept running after hybrid mode is switched off until it has ramped out
+    const bool runTail = parameters.hybridTail || tailSounding;
+
+    if (runTail)
+        for (int ch = 0; ch < numChannels; ++ch)
+            tailInputBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+
+    // 1) Convolution - zero latency, tail stages run on the worker thread.
+    //    Pre-delay is part of the partition schedule. Cuts and IR gain run
+    //    through postProcess, and only while the kernel doesn't have them
+    //    baked in
     {
         juce::dsp::AudioBlock<float> block(buffer);
+        juce::dsp::ProcessContextReplacing<float> context(block);
+        convolver.process(context, this);
+    }
 
-        if (numChannels >= 1)
-        {
-            auto ch0 = block.getSingleChannelBlock(0);
-            juce::dsp::ProcessContextReplacing<float> ctx0(ch0);
-            preDelayL.process(ctx0);
-        }
+    if (toneSettleSamples > 0)
+    {
+        toneSettleSamples -= numSamples;
+
+        if (toneSettleSamples <= 0 && parameters.bakeTone)
+            requestToneBake();
+    }
+
+    // 2) Late tail (hybrid mode) - picks up where the early kernel fades out,
+    //    through the same cuts and IR gain as the convolution
+    tailSounding = false;
+
+    if (runTail)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            tailOutputBuffer.clear(ch, 0, numSamples);
+
+        juce::dsp::AudioBlock<const float> tailIn(tailInputBuffer.getArrayOfReadPointers(),
+                                                  (size_t)numChannels, (size_t)numSamples);
+        juce::dsp::AudioBlock<float> tailOut(tailOutputBuffer.getArrayOfWritePointers(),
+                                             (size_t)numChannels, (size_t)numSamples);
 
-        if (numChannels >= 2)
+        tailSounding = lateTail.process(tailIn, tailOut);
+
+        if (tailSounding)
         {
-            auto ch1 = block.getSingleChannelBlock(1);
-            juce::dsp::ProcessContextReplacing<float> ctx1(ch1);
-            preDelayR.process(ctx1);
+            juce::dsp::ProcessContextReplacing<float> ctx(tailOut);
+            tailLowCut.process(ctx);
+            tailHighCut.process(ctx);
+
+            smoothedTailGain.applyGain(tailOutputBuffer, numSamples);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.addFrom(ch, 0, tailOutputBuffer, ch, 0, numSamples);
         }
     }
 
-    // 2) Convolution
+    if (!tailSounding)
+        smoothedTailGain.skip(numSamples);
+
+    // 3) Dry/wet mix
+    dryWetMixer.mixWetSamples(juce::dsp::AudioBlock<float>(buffer));
+
+    // 4) Into or out of Bypass - the untouched input is part of both sides,
+    //    so a straight (equal-gain) ramp
+    if (bypassFading)
     {
-        juce::dsp::AudioBlock<float> block(buffer);
-        juce::dsp::ProcessContextReplacing<float> context(block);
-        convolver.process(context);
+        for (int n = 0; n < numSamples; ++n)
+        {
+            const float g = bypassMix.getNextValue();
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                float* out = buffer.getWritePointer(ch);
+                out[n] += g * (bypassDryBuffer.getSample(ch, n) - out[n]);
+            }
+        }
     }
+}
+
+bool Convolution::isBypassIR() const
+{
+    return bypassKernel.load(std::memory_order_acquire);
+}
 
-    // 3) Tone shaping - two stereo process calls instead of four mono ones
+void Convolution::resetPostProcessing()
+{
+    lowCut.reset();
+    highCut.reset();
+}
+
+void Convolution::postProcess(juce::dsp::AudioBlock<float>& block)
+{
+    const int numSamples  = (int)block.getNumSamples();
+    const int numChannels = (int)block.getNumChannels();
+
+    // Tone shaping - two stereo process calls instead of four mono ones
     {
-        juce::dsp::AudioBlock<float> block(buffer);
         juce::dsp::ProcessContextReplacing<float> ctx(block);
         lowCut.process(ctx);
         highCut.process(ctx);
     }
 
-    // 4) IR gain - setTargetValue is now called only in setParameters when
-    //    irGainDb changes, so here we just apply whatever the smoother holds
+    // IR gain - setTargetValue is now called only in setParameters when
+    // irGainDb changes, so here we just apply whatever the smoother holds
     if (smoothedIRGain.isSmoothing())
     {
         for (int ch = 0; ch < numChannels; ++ch)
         {
-            auto* data = buffer.getWritePointer(ch);
+            auto* data = block.getChannelPointer((size_t)ch);
             for (int n = 0; n < numSamples; ++n)
                 data[n] *= smoothedIRGain.getNextValue();
         }
@@ -185,33 +476,31 @@ void Convolution::processBlock(juce::AudioBuffer<float>& buffer,
     {
         const float irGain = smoothedIRGain.getCurrentValue();
         for (int ch = 0; ch < numChannels; ++ch)
-            juce::FloatVectorOperations::multiply(buffer.getWritePointer(ch), irGain, numSamples);
+            juce::FloatVectorOperations::multiply(block.getChannelPointer((size_t)ch), irGain, numSamples);
     }
-
-    // 5) Dry/wet mix
-    dryWetMixer.mixWetSamples(juce::dsp::AudioBlock<float>(buffer));
 }
 
 void Convolution::loadIR(const juce::File& file)
 {
+    const juce::ScopedLock sl(loader->getLock());
+
     if (!file.existsAsFile())
     {
         DBG("Convolution::loadIR - ERROR: File does not exist: " + file.getFullPathName());
         return;
     }
 
-    try
-    {
-        convolver.loadImpulseResponse(file,
-                                      juce::dsp::Convolution::Stereo::yes,
-                                      juce::dsp::Convolution::Trim::no,
-                                      0);
-        DBG("Convolution::loadIR - Loaded: " + file.getFullPathName());
-    }
-    catch (const std::exception& e)
+    // Shared with every other slot and instance using this file at this rate
+    auto ir = irCache->getIR(file, prepared ? currentSampleRate : 0.0);
+
+    if (ir == nullptr)
     {
-        DBG("Convolution::loadIR - Exception: " + juce::String(e.what()));
+        DBG("Convolution::loadIR - ERROR: Could not read: " + file.getFullPathName());
+        return;
     }
+
+    setImpulseResponse(std::move(ir), file);
+    DBG("Convolution::loadIR - Loaded: " + file.getFullPathName());
 }
 
 void Convolution::loadIRFromMemory(const void* data,
@@ -221,37 +510,270 @@ void Convolution::loadIRFromMemory(const void* data,
 {
     juce::ignoreUnused(sampleRate, numChannels);
 
+    const juce::ScopedLock sl(loader->getLock());
+
     if (data == nullptr || dataSize == 0)
     {
         DBG("Convolution::loadIRFromMemory - ERROR: Invalid data or size");
         return;
     }
 
-    try
+    auto ir = irCache->decodeFromMemory(data, dataSize);
+
+    if (ir == nullptr)
     {
-        convolver.loadImpulseResponse(data,
-                                      dataSize,
-                                      juce::dsp::Convolution::Stereo::yes,
-                                      juce::dsp::Convolution::Trim::no,
-                                      0);
-        DBG("Convolution::loadIRFromMemory - Loaded IR from memory");
+        DBG("Convolution::loadIRFromMemory - ERROR: Could not read IR data");
+        return;
     }
-    catch (const std::exception& e)
+
+    setImpulseResponse(std::move(ir), {});
+    DBG("Convolution::loadIRFromMemory - Loaded IR from memory");
+}
+
+void Convolution::setImpulseResponse(IRCache::IRPtr ir, const juce::File& sourceFile, int bankIndex)
+{
+    irSource          = std::move(ir);
+    irSourceFile      = sourceFile;
+    irSourceBankIndex = bankIndex;
+    rebuildKernel();
+
+    // After the kernel, so the audio thread never sees the flag without it
+    bypassKernel.store(bankIndex == 0, std::memory_order_release);
+}
+
+// Brings the stored IR to the current rate, normalises it the way
+// juce::dsp::Convolution did, and partitions it for the engine (or picks up
+// the partitions another instance already built)
+void Convolution::rebuildKernel()
+{
+    if (irSource == nullptr)
+        return;
+
+    auto source = irSource;
+
+    if (prepared && source->sampleRate > 0.0 && source->sampleRate != currentSampleRate)
     {
-        DBG("Convolution::loadIRFromMemory - Exception: " + juce::String(e.what()));
+        // File and bank IRs come from the cache (or the IR pack) at the new
+        // rate and replace the held entry; memory IRs are resampled from their
+        // original data each time so repeated re-prepares never compound
+        if (irSourceFile != juce::File())
+            source = irSource = irCache->getIR(irSourceFile, currentSampleRate);
+        else if (irSourceBankIndex > 0 && irBank != nullptr)
+            source = irSource = irBank->getIR(irSourceBankIndex, currentSampleRate);
+        else
+            source = IRCache::resample(*source, currentSampleRate);
+
+        if (source == nullptr)
+            return;
     }
+
+    // Where the Schroeder decay reaches the noise floor, or the IR length
+    // parameter if that is shorter. Everything past it costs CPU for nothing
+    // audible. Unlimited at the top of the parameter range.
+    kernelIRLength = requestedIRLength.load(std::memory_order_relaxed);
+
+    const int fullLength = source->buffer.getNumSamples();
+    const double irRate  = source->sampleRate > 0.0 ? source->sampleRate : currentSampleRate;
+
+    int length = fullLength;
+
+    if (fullLength > 1)
+    {
+        // Pack IRs carry the trim point for the default floor, and the bank's
+        // background analysis has it for its loose files
+        const auto analysis = (irSourceBankIndex > 0 && irBank != nullptr)
+                                ? irBank->getIRInfo(irSourceBankIndex).analysis
+                                : nullptr;
+
+        if (source->trimPoint > 0 && trimFloorDb == IRAnalysis::kDefaultTrimFloorDb)
+            length = source->trimPoint;
+        else if (analysis != nullptr && trimFloorDb == IRAnalysis::kDefaultTrimFloorDb)
+            length = juce::jlimit(1, fullLength, (int) std::ceil(analysis->effectiveLengthSeconds * irRate));
+        else
+            length = IRAnalysis::findTrimPoint(source->buffer, trimFloorDb);
+
+        if (kernelIRLength < kMaxIRLengthSeconds)
+            length = juce::jmin(length, juce::jmax(1, (int) (kernelIRLength * irRate)));
+    }
+
+    // Hybrid: the FDN takes over past the early part, so only that much is
+    // convolved. The fit reads the whole (trimmed) IR's decay; it is kept
+    // until the IR, its length or the handover changes.
+    kernelHybridTail = requestedHybridTail.load(std::memory_order_relaxed);
+    kernelEarlyMs    = requestedEarlyMs   .load(std::memory_order_relaxed);
+    tailEngaged      = false;
+
+    const int handover = (int) (juce::jlimit(1.0f, kMaxEarlyMs, kernelEarlyMs) * 0.001 * irRate);
+
+    if (kernelHybridTail && prepared && fullLength > 1 && length > handover)
+    {
+        if (source.get() != tailSourceID || length != tailFitLength || handover != tailFitHandover)
+        {
+            auto ir = source->buffer;
+
+            if (!source->normalised)
+                ir.applyGain(IRAnalysis::getNormalisationGain(ir));
+
+            ir.setSize(ir.getNumChannels(), length, true);
+
+            // The same fade the early kernel ends with below
+            tailDesign      = FDNLateTail::fit(ir, irRate, handover, juce::jmin(handover / 4, (int) (0.05 * irRate)));
+            tailSourceID    = source.get();
+            tailFitLength   = length;
+            tailFitHandover = handover;
+        }
+
+        // Too little past the handover to fit - the whole IR is convolved
+        if (tailDesign.active)
+        {
+            length      = handover;
+            tailEngaged = true;
+        }
+    }
+
+    pushTailDesign();
+
+    // Raised-cosine fade over the last quarter, at most 50 ms
+    const int fadeLength = length < fullLength
+                             ? juce::jmin(length / 4, (int) (0.05 * irRate))
+                             : 0;
+
+    // Every Convolution running this IR at this rate, head size and length
+    // shares the same spectra - only the first one pays for the FFTs
+    const int headSize = convolver.getHeadSize();
+
+    // Only the first few seconds of a long IR stay in memory
+    const int residentSamples = (int) (kResidentIRSeconds * irRate);
+    const int residentLength  = length > residentSamples ? residentSamples : -1;
+
+    // A new version of the IR already playing (other length, tone, head size)
+    // sounds nearly the same, so it fades in at equal gain
+    const auto curve = source.get() == kernelSourceID ? PartitionedConvolver::Crossfade::equalGain
+                                                      : PartitionedConvolver::Crossfade::equalPower;
+    kernelSourceID = source.get();
+
+    // Normalised and cut to length - what both kernels below are built from
+    auto prepareIR = [&source, length, fadeLength]
+    {
+        auto ir = source->buffer;
+
+        // A unit impulse (Bypass) is kept as-is so the dry signal passes unchanged
+        if (!source->normalised && ir.getNumSamples() > 1)
+            ir.applyGain(IRAnalysis::getNormalisationGain(ir));
+
+        if (length < ir.getNumSamples())
+            IRAnalysis::truncateWithFade(ir, length, fadeLength);
+
+        return ir;
+    };
+
+    auto plain = kernelCache->getOrCreate(source, headSize, length, {},
+                                          [&source, &prepareIR, headSize, length, residentLength]
+    {
+        // Pack IRs are stored normalised - partition straight from the mapping
+        if (source->normalised && length == source->buffer.getNumSamples())
+            return PartitionedConvolver::createKernel(source->buffer, headSize, false, residentLength);
+
+        return PartitionedConvolver::createKernel(prepareIR(), headSize, false, residentLength);
+    });
+
+    // What the audio thread asked for - remembered even when this IR can't
+    // take it, so the request isn't serviced again on every wake
+    kernelToneBaked = requestedToneBake.load(std::memory_order_acquire);
+    bakedLowCutHz   = requestedLowCutHz .load(std::memory_order_relaxed);
+    bakedHighCutHz  = requestedHighCutHz.load(std::memory_order_relaxed);
+    bakedIRGainDb   = requestedIRGainDb .load(std::memory_order_relaxed);
+
+    // Bypass stays a unit impulse; the live filters handle it
+    if (!kernelToneBaked || !prepared || fullLength <= 1)
+    {
+        plainKernel = nullptr;
+        convolver.setKernel(std::move(plain), curve);
+        return;
+    }
+
+    plainKernel = std::move(plain);
+
+    const double sr   = currentSampleRate;
+    const float  gain = juce::Decibels::decibelsToGain(bakedIRGainDb);
+    float lowHz  = bakedLowCutHz;
+    float highHz = bakedHighCutHz;
+    clampToneFrequencies((float)sr, lowHz, highHz);
+
+    convolver.setKernel(kernelCache->getOrCreate(source, headSize, length,
+                                                 KernelCache::Variant::tone(lowHz, highHz, gain),
+                                                 [&prepareIR, headSize, residentLength, sr, gain, lowHz, highHz]
+    {
+        auto ir = prepareIR();
+
+        // Room for the low cut to ring out past the end of the IR - its Q = 1
+        // poles are about 60 dB down after seven time constants
+        const int ringOut = juce::jmin((int)(7.0 / (juce::MathConstants<double>::pi * lowHz) * sr),
+                                       (int)(0.25 * sr));
+
+        ir.setSize(ir.getNumChannels(), ir.getNumSamples() + ringOut, true, true);
+
+        // The same filters postProcess would run, applied to the IR once
+        auto lowCoeffs  = juce::dsp::IIR::Coefficients<float>::makeHighPass(sr, lowHz,  1.0f);
+        auto highCoeffs = juce::dsp::IIR::Coefficients<float>::makeLowPass (sr, highHz, 1.0f);
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            juce::dsp::IIR::Filter<float> low(lowCoeffs), high(highCoeffs);
+            float* data = ir.getWritePointer(ch);
+
+            for (int n = 0; n < ir.getNumSamples(); ++n)
+                data[n] = high.processSample(low.processSample(data[n])) * gain;
+        }
+
+        return PartitionedConvolver::createKernel(ir, headSize, true, residentLength);
+    }), curve);
+}
+
+void Convolution::setTrimFloorDb(float floorDb)
+{
+    const juce::ScopedLock sl(loader->getLock());
+
+    if (floorDb == trimFloorDb)
+        return;
+
+    trimFloorDb = floorDb;
+    rebuildKernel();
+}
+
+void Convolution::setHeadSize(int headSize)
+{
+    const juce::ScopedLock sl(loader->getLock());
+
+    if (juce::nextPowerOfTwo(headSize) == convolver.getHeadSize())
+        return;
+
+    convolver.setHeadSize(headSize);
+    rebuildKernel();
 }
 
 void Convolution::setIRBank(std::shared_ptr<IRBank> bank)
 {
+    const juce::ScopedLock sl(loader->getLock());
+
+    if (irBank)
+        irBank->removeListener(this);
+
     irBank = bank;
+    currentIRIndex = -1;
+
+    if (irBank)
+        irBank->addListener(this);
 
-    if (irBank && irBank->getNumIRs() > 0)
-        loadIRAtIndex(0);
+    // The loader picks up whatever index was last requested (Bypass until the
+    // first setParameters)
+    loader->wake();
 }
 
 void Convolution::loadIRAtIndex(int index)
 {
+    const juce::ScopedLock sl(loader->getLock());
+
     if (!irBank)
     {
         DBG("Convolution::loadIRAtIndex - ERROR: No IR bank set");
@@ -260,7 +782,9 @@ void Convolution::loadIRAtIndex(int index)
 
     if (!juce::isPositiveAndBelow(index, irBank->getNumIRs()))
     {
-        DBG("Convolution::loadIRAtIndex - ERROR: Index out of range: " + juce::String(index));
+        // Still discovering - loaded once the bank reports its list
+        if (irBank->isReady())
+            DBG("Convolution::loadIRAtIndex - ERROR: Index out of range: " + juce::String(index));
         return;
     }
 
@@ -269,40 +793,28 @@ void Convolution::loadIRAtIndex(int index)
 
     if (index == 0)
     {
-        reset();
+        auto impulse = std::make_shared<IRCache::DecodedIR>();
+        impulse->buffer.setSize(1, 1);
+        impulse->buffer.setSample(0, 0, 1.0f);
 
-        std::vector<float> impulse(1, 1.0f);
+        // Rate 0 = rate independent, never resampled
+        setImpulseResponse(std::move(impulse), {}, 0);
 
-        try
-        {
-            convolver.loadImpulseResponse(
-                impulse.data(),
-                impulse.size(),
-                juce::dsp::Convolution::Stereo::no,
-                juce::dsp::Convolution::Trim::no,
-                1);
-
-            DBG("Convolution::loadIRAtIndex - Loaded BYPASS IR");
-            currentIRIndex = 0;
-        }
-        catch (const std::exception& e)
-        {
-            DBG("Convolution::loadIRAtIndex - Exception loading bypass IR: " + juce::String(e.what()));
-        }
+        DBG("Convolution::loadIRAtIndex - Loaded BYPASS IR");
+        currentIRIndex = 0;
         return;
     }
 
-    auto irFile = irBank->getIRFile(index);
+    auto ir = irBank->getIR(index, prepared ? currentSampleRate : 0.0);
 
-    if (!irFile.existsAsFile())
+    if (ir == nullptr)
     {
-        DBG("Convolution::loadIRAtIndex - ERROR: IR file missing for index "
-            + juce::String(index) + ": " + irFile.getFullPathName());
+        DBG("Convolution::loadIRAtIndex - ERROR: Could not load IR " + juce::String(index)
+            + ": " + irBank->getIRName(index));
         return;
     }
 
-    reset();
-    loadIR(irFile);
+    setImpulseResponse(std::move(ir), {}, index);
     currentIRIndex = index;
 }
 
@@ -314,9 +826,10 @@ void Convolution::loadCustomIR(const juce::File& file)
         return;
     }
 
-    reset();
+    const juce::ScopedLock sl(loader->getLock());
+
     loadIR(file);
-    customIRActive = true;
+    customIRActive.store(true, std::memory_order_relaxed);
     customIRPath   = file.getFullPathName();
     currentIRIndex = -1;
     DBG("Convolution::loadCustomIR - Loaded: " + file.getFullPathName());
@@ -324,7 +837,12 @@ void Convolution::loadCustomIR(const juce::File& file)
 
 void Convolution::clearCustomIR()
 {
-    customIRActive = false;
+    const juce::ScopedLock sl(loader->getLock());
+
+    customIRActive.store(false, std::memory_order_relaxed);
     customIRPath   = {};
     currentIRIndex = -1;
+
+    // Back to the bank IR the parameter points at
+    loader->wake();
 }
\ No newline at end of file
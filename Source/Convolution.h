@@ -7,8 +7,41 @@
   #include <juce_dsp/juce_dsp.h>
 #endif
 
+#include "IRAnalysis.h"
+#include "IRBank.h"
+#include "FDNLateTail.h"
+#include "IRCache.h"
+#include "PartitionedConvolver.h"
+
 // Forward declaration
-class IRBank;
+class Convolution;
+
+// Background thread shared by every Convolution in the process (held through
+// juce::SharedResourcePointer). IR changes requested from the audio thread are
+// only recorded there; this thread decodes and partitions the new IR and hands
+// the finished kernel to the engine, which crossfades it in.
+class IRLoadThread : private juce::Thread
+{
+public:
+    IRLoadThread();
+    ~IRLoadThread() override;
+
+    void addClient(Convolution* client);
+    void removeClient(Convolution* client);
+
+    void wake() { notify(); }
+
+    // Serialises every IR load, re-partition and prepare across the process
+    juce::CriticalSection& getLock() { return lock; }
+
+private:
+    void run() override;
+
+    juce::CriticalSection lock;
+    juce::Array<Convolution*> clients;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IRLoadThread)
+};
 
 // Parameters for the convolution reverb engine
 struct ConvolutionParameters
@@ -21,10 +54,21 @@ struct ConvolutionParameters
 
     float lowCutHz   = 80.0f;    // high pass cutoff
     float highCutHz  = 12000.0f; // low pass cutoff
+
+    float irLengthSec = 20.0f;   // IR is cut (with a fade) past this; max = full length
+
+    bool  bakeTone   = true;     // fold the cuts and IR gain into the IR once they settle
+    bool  midInput   = false;    // mono IRs: convolve (L + R) / 2 once for both sides
+
+    bool  hybridTail = false;    // convolve only the early part, FDN for the rest
+    float earlyMs    = 120.0f;   // hybrid: where the FDN takes over
 };
 
-// Simple stereo convolution reverb wrapper using juce::dsp::Convolution
-class Convolution
+// Stereo convolution reverb built on PartitionedConvolver (zero latency,
+// long tails computed on the shared worker thread). Four-channel IRs run
+// true stereo.
+class Convolution : private IRBank::Listener,
+                    private PartitionedConvolver::PostProcessor
 {
 public:
     Convolution();
@@ -38,50 +82,149 @@ public:
 
     void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi);
 
+    // Offline: tail stages the worker is late with are waited for, not dropped
+    void setNonRealtime(bool isNonRealtime) { convolver.setNonRealtime(isNonRealtime); }
+
     void loadIR(const juce::File& file);
     void loadIRFromMemory(const void* data,
                           size_t dataSize,
                           double sampleRate,
                           int numChannels);
 
+    // The loading functions block while decoding and partitioning - call them
+    // from the message thread, never from processBlock. IR index changes that
+    // arrive through setParameters are handed to the IRLoadThread instead.
     void setIRBank(std::shared_ptr<IRBank> bank);
     void loadIRAtIndex(int index);
 
     void loadCustomIR(const juce::File& file);
     void clearCustomIR();
-    bool hasCustomIR()          const { return customIRActive; }
+    bool hasCustomIR()          const { return customIRActive.load(std::memory_order_relaxed); }
     juce::String getCustomIRPath() const { return customIRPath; }
 
+    static constexpr float kMaxIRLengthSeconds = 20.0f;
+
+    // IR past this point is streamed from disk by the engine rather than held
+    // in memory, so very long IRs cost a bounded amount of RAM per kernel
+    static constexpr double kResidentIRSeconds = 4.0;
+
+    // Longest early part the hybrid mode convolves before the FDN takes over
+    static constexpr float kMaxEarlyMs = 250.0f;
+
+    // How long low cut, high cut and IR gain have to stay put before they are
+    // baked into the IR
+    static constexpr double kToneSettleSeconds = 0.2;
+
+    // Level on the IR's energy decay curve below which the tail is dropped
+    // (default -90 dB). Re-partitions the current IR. Not realtime safe.
+    void  setTrimFloorDb(float floorDb);
+    float getTrimFloorDb() const { return trimFloorDb; }
+
+    // Direct-form head length of the convolution engine, in samples.
+    // Re-partitions the current IR when it changes. Not realtime safe.
+    void setHeadSize(int headSize);
+    int  getHeadSize() const { return convolver.getHeadSize(); }
+
 private:
+    friend class IRLoadThread;
+
+    // Called on the IRLoadThread with its lock held
+    void serviceLoadRequest();
+
+    // IRBank discovery finished - the index being asked for may exist now
+    void irListChanged() override;
+
+    // Cuts and IR gain, run by the engine on kernels that don't have them baked in
+    void postProcess(juce::dsp::AudioBlock<float>& block) override;
+
+    // A baked kernel handing back to the live filters - clears what they
+    // held from before it
+    void resetPostProcessing() override;
+
+    // Audio thread - hands the settled tone to the loader for baking
+    void requestToneBake();
+
+    // The loader last handed the engine the Bypass impulse - the engine is
+    // skipped entirely once it plays
+    bool isBypassIR() const;
+
     void updateFilters();
-    void updatePreDelay();
+    static void clampToneFrequencies(float sampleRate, float& lowHz, float& highHz);
+    void updatePreDelay();   // loader side
+    void pushTailDesign();   // loader side
+    void setImpulseResponse(IRCache::IRPtr ir, const juce::File& sourceFile, int bankIndex = -1);
+    void rebuildKernel();
 
     ConvolutionParameters parameters;
 
     bool   prepared          = false;
     double currentSampleRate = 44100.0;
-    float  preDelaySamples   = 0.0f;
-    bool   isPreDelayActive  = false;
-    int    currentIRIndex    = -1;
-    bool   customIRActive    = false;
+    int    currentIRIndex    = -1;   // loader side - what the engine was last given
     juce::String customIRPath;
 
+    // Loader side - settings the current kernel was built with
+    float kernelIRLength = kMaxIRLengthSeconds;
+    float trimFloorDb    = IRAnalysis::kDefaultTrimFloorDb;
+    const void* kernelSourceID = nullptr;   // identity only, never dereferenced
+    float appliedPreDelayMs = 0.0f;
+    bool  kernelToneBaked = false;
+    float bakedLowCutHz   = 0.0f;
+    float bakedHighCutHz  = 0.0f;
+    float bakedIRGainDb   = 0.0f;
+    bool  kernelHybridTail = false;
+    float kernelEarlyMs    = 0.0f;
+
+    // Loader side - the late tail fitted to the current IR, and what it was
+    // fitted from (so tone and pre-delay changes don't refit it)
+    FDNLateTail::Design tailDesign;
+    const void* tailSourceID = nullptr;   // identity only, never dereferenced
+    int tailFitLength   = 0;
+    int tailFitHandover = 0;
+    bool tailEngaged    = false;   // the current kernel stops at the handover
+
+    // Audio thread - samples left until the tone counts as settled
+    int toneSettleSamples = 0;
+
+    // Written by the audio thread, read by the loader
+    std::atomic<int>   requestedIRIndex  { 0 };
+    std::atomic<float> requestedIRLength { kMaxIRLengthSeconds };
+    std::atomic<float> requestedPreDelayMs { 0.0f };
+    std::atomic<bool>  requestedMidInput   { false };
+    std::atomic<bool>  requestedHybridTail { false };
+    std::atomic<float> requestedEarlyMs    { 120.0f };
+    std::atomic<bool>  customIRActive    { false };
+    std::atomic<bool>  irBankChanged     { false };
+    std::atomic<bool>  requestedToneBake { false };
+    std::atomic<float> requestedLowCutHz  { 0.0f };
+    std::atomic<float> requestedHighCutHz { 0.0f };
+    std::atomic<float> requestedIRGainDb  { 0.0f };
+
+    // Written by the loader once the kernel is handed over, read by the audio thread
+    std::atomic<bool> bypassKernel { false };
+
+    juce::SharedResourcePointer<IRLoadThread> loader;
+
     // Cached filter frequencies - avoids recomputing coefficients when unchanged
     float lastLowCutHz  = -1.0f;
     float lastHighCutHz = -1.0f;
 
     std::shared_ptr<IRBank> irBank;
 
-    juce::dsp::Convolution convolver;
+    juce::SharedResourcePointer<IRCache>     irCache;
+    juce::SharedResourcePointer<KernelCache> kernelCache;
+
+    // Current IR, shared with the cache. It came from irSourceFile (custom or
+    // loadIR), from the bank at irSourceBankIndex, or from neither (Bypass,
+    // loadIRFromMemory).
+    IRCache::IRPtr irSource;
+    juce::File     irSourceFile;
+    int            irSourceBankIndex = -1;
 
-    static constexpr int kMaxPreDelaySeconds = 2;
-    static constexpr int kMaxSampleRate      = 192000;
-    static constexpr int kMaxDelaySamples    = kMaxPreDelaySeconds * kMaxSampleRate;
+    PartitionedConvolver convolver;
 
-    // None interpolation: pre-delay is always a static value, no sub-sample
-    // accuracy needed, avoids a multiply-add per sample vs Linear
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> preDelayL { kMaxDelaySamples };
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None> preDelayR { kMaxDelaySamples };
+    // The unbaked kernel, kept while a baked one plays so that touching a
+    // tone control swaps back without re-partitioning
+    KernelCache::KernelPtr plainKernel;
 
     // Two stereo filters instead of four mono filters - halves filter overhead
     // and avoids branching on numChannels in processBlock
@@ -93,6 +236,22 @@ private:
 
     juce::dsp::DryWetMixer<float> dryWetMixer;
 
+    // Hybrid mode: the FDN hears the input the convolution hears and adds
+    // onto the wet signal. Its own cuts, since baked kernels skip the live ones.
+    FDNLateTail lateTail;
+    juce::AudioBuffer<float> tailInputBuffer;
+    juce::AudioBuffer<float> tailOutputBuffer;
+    StereoFilter tailLowCut;
+    StereoFilter tailHighCut;
+    juce::SmoothedValue<float> smoothedTailGain;
+    bool tailSounding = false;   // the FDN added something last block
+
+    // Bypass IR: 1 = input passes untouched and nothing else runs. Ramps over
+    // the engine's crossfade time when Bypass is picked or left.
+    juce::SmoothedValue<float> bypassMix;
+    juce::AudioBuffer<float>   bypassDryBuffer;
+    bool engineIdle = false;   // process() skipped since the last block
+
     // Smoothed IR gain - setTargetValue is called only when irGainDb changes,
     // not every block
     juce::SmoothedValue<float> smoothedIRGain;
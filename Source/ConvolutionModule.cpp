@@ -23,8 +23,13 @@ void ConvolutionModule::rebuildParamIDs()
     pPreDelay = moduleID + ".preDelay";
     pIrIndex  = moduleID + ".convIrIndex";
     pIrGain   = moduleID + ".convIrGain";
+    pIrLength = moduleID + ".convIrLength";
     pLowCut   = moduleID + ".convLowCut";
     pHighCut  = moduleID + ".convHighCut";
+    pBakeTone = moduleID + ".convBakeTone";
+    pMidInput = moduleID + ".convMidInput";
+    pHybridTail = moduleID + ".convHybridTail";
+    pEarlyMs    = moduleID + ".convEarlyMs";
     pEnabled  = moduleID + ".enabled";
 }
 
@@ -42,8 +47,13 @@ void ConvolutionModule::process(juce::AudioBuffer<float>& buffer,
     params.preDelay  = state.getRawParameterValue(pPreDelay) ->load();
     params.irIndex   = (int)state.getRawParameterValue(pIrIndex)  ->load();
     params.irGainDb  = state.getRawParameterValue(pIrGain)   ->load();
+    params.irLengthSec = state.getRawParameterValue(pIrLength)->load();
     params.lowCutHz  = state.getRawParameterValue(pLowCut)   ->load();
     params.highCutHz = state.getRawParameterValue(pHighCut)  ->load();
+    params.bakeTone  = state.getRawParameterValue(pBakeTone) ->load() > 0.5f;
+    params.midInput  = state.getRawParameterValue(pMidInput) ->load() > 0.5f;
+    params.hybridTail = state.getRawParameterValue(pHybridTail)->load() > 0.5f;
+    params.earlyMs    = state.getRawParameterValue(pEarlyMs)   ->load();
 
     convolutionReverb.setParameters(params);
 
@@ -58,8 +68,13 @@ std::vector<juce::String> ConvolutionModule::getUsedParameters() const
         "preDelay",
         "convIrIndex",
         "convIrGain",
+        "convIrLength",
         "convLowCut",
-        "convHighCut"
+        "convHighCut",
+        "convBakeTone",
+        "convMidInput",
+        "convHybridTail",
+        "convEarlyMs"
     };
 }
 
@@ -79,6 +94,11 @@ juce::String ConvolutionModule::getType() const
     return "Convolution";
 }
 
+void ConvolutionModule::setNonRealtime(bool isNonRealtime)
+{
+    convolutionReverb.setNonRealtime(isNonRealtime);
+}
+
 void ConvolutionModule::setIRBank(std::shared_ptr<IRBank> bank)
 {
     convolutionReverb.setIRBank(bank);
@@ -22,6 +22,8 @@ public:
 
     std::vector<juce::String> getUsedParameters() const override;
 
+    void setNonRealtime(bool isNonRealtime) override;
+
     void setID(juce::String& newID) override;
     juce::String getID()   const override;
     juce::String getType() const override;
@@ -40,7 +42,7 @@ private:
     Convolution convolutionReverb;
 
     // Pre-built parameter IDs - avoids String heap allocation every process block
-    juce::String pMix, pPreDelay, pIrIndex, pIrGain, pLowCut, pHighCut, pEnabled;
+    juce::String pMix, pPreDelay, pIrIndex, pIrGain, pIrLength, pLowCut, pHighCut, pBakeTone, pMidInput, pHybridTail, pEarlyMs, pEnabled;
 
     void rebuildParamIDs();
 };
\ No newline at end of file
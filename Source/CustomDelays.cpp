@@ -69,43 +69,261 @@ void DelayLineWithSampleAccess<SampleType>::setDelay(float newDelayInSamples)
 }
 
 template <typename SampleType>
-SampleType DelayLineWithSampleAccess<SampleType>::readFractional(int channel, float delaySamples) const
+SampleType DelayLineWithSampleAccess<SampleType>::readFractional(int channel, float delaySamples)
 {
+    return interpolate(channel, writePosition[(size_t) channel], delaySamples);
+}
+
+template <typename SampleType>
+SampleType DelayLineWithSampleAccess<SampleType>::interpolate(int channel, int writePos, float delaySamples)
+{
+    const SampleType* ring = delayBuffer.getReadPointer(channel);
+
+    // Ring index m samples back from writePos
+    auto back = [&] (int m) { const int idx = writePos - m; return idx < 0 ? idx + numSamples : idx; };
+
+    switch (interpolation)
+    {
+        case DelayInterpolation::Lagrange3:
+        {
+            delaySamples = juce::jlimit(1.0f, (float)(numSamples - 3), delaySamples);
+
+            int delayInt = (int) std::floor(delaySamples);
+            SampleType frac = (SampleType) (delaySamples - (float) delayInt);
+
+            // Centre the fraction between the middle two of the four points
+            if (delayInt >= 2)
+            {
+                --delayInt;
+                frac += (SampleType) 1;
+            }
+
+            const SampleType v1 = ring[back(delayInt)];
+            const SampleType v2 = ring[back(delayInt + 1)];
+            const SampleType v3 = ring[back(delayInt + 2)];
+            const SampleType v4 = ring[back(delayInt + 3)];
+
+            const SampleType d1 = frac - (SampleType) 1;
+            const SampleType d2 = frac - (SampleType) 2;
+            const SampleType d3 = frac - (SampleType) 3;
+
+            const SampleType c1 = -d1 * d2 * d3 / (SampleType) 6;
+            const SampleType c2 =  d2 * d3 * (SampleType) 0.5;
+            const SampleType c3 = -d1 * d3 * (SampleType) 0.5;
+            const SampleType c4 =  d1 * d2 / (SampleType) 6;
+
+            return v1 * c1 + frac * (v2 * c2 + v3 * c3 + v4 * c4);
+        }
+
+        case DelayInterpolation::Thiran:
+        {
+            delaySamples = juce::jlimit(1.0f, (float)(numSamples - 2), delaySamples);
+
+            int delayInt = (int) std::floor(delaySamples);
+            SampleType frac = (SampleType) (delaySamples - (float) delayInt);
+
+            // Keep the fraction in [0.618, 1.618), where the allpass pole is
+            // far enough from the unit circle to settle quickly
+            if (frac < (SampleType) 0.618 && delayInt >= 2)
+            {
+                --delayInt;
+                frac += (SampleType) 1;
+            }
+
+            const SampleType v1 = ring[back(delayInt)];
+            const SampleType v2 = ring[back(delayInt + 1)];
+
+            const SampleType alpha = ((SampleType) 1 - frac) / ((SampleType) 1 + frac);
+            const SampleType out   = frac == (SampleType) 0 ? v1 : v2 + alpha * (v1 - v[(size_t) channel]);
+
+            v[(size_t) channel] = out;
+            return out;
+        }
+
+        case DelayInterpolation::Linear:
+        default:
+            break;
+    }
+
     delaySamples = juce::jlimit(1.0f, (float)(numSamples - 1), delaySamples);
 
-    const int writePos = writePosition[(size_t) channel];
     const int delayInt = (int) std::floor(delaySamples);
     const float frac = delaySamples - (float) delayInt;
 
-    const int idx1 = (writePos - delayInt + numSamples) % numSamples;
-    const int idx2 = (writePos - delayInt - 1 + numSamples) % numSamples;
-
-    const SampleType s1 = delayBuffer.getSample(channel, idx1);
-    const SampleType s2 = delayBuffer.getSample(channel, idx2);
+    const SampleType s1 = ring[back(delayInt)];
+    const SampleType s2 = ring[back(delayInt + 1)];
 
     return s1 + frac * (s2 - s1);
 }
 
+template <typename SampleType>
+void DelayLineWithSampleAccess<SampleType>::setInterpolation(DelayInterpolation newInterpolation)
+{
+    if (newInterpolation == interpolation)
+        return;
+
+    interpolation = newInterpolation;
+    std::fill(v.begin(), v.end(), (SampleType) 0);
+}
+
 template <typename SampleType>
 void DelayLineWithSampleAccess<SampleType>::setSize(const int numChannels, const int newSize)
 {
     totalSize = newSize;
     delayBuffer.setSize(numChannels, totalSize, false, false, true);
+    numSamples = delayBuffer.getNumSamples();
     reset();
 }
 
+template <typename SampleType>
+void DelayLineWithSampleAccess<SampleType>::setMaximumDelayInSamples(int maximumDelayInSamples)
+{
+    jassert(maximumDelayInSamples >= 0);
+    totalSize = std::max(maximumDelayInSamples + 1, 4);
+}
+
 template <typename SampleType>
 int DelayLineWithSampleAccess<SampleType>::getNumSamples() const
 {
     return delayBuffer.getNumSamples();
 }
 
+template <typename SampleType>
+const SampleType* DelayLineWithSampleAccess<SampleType>::getReadPointer(int channel) const
+{
+    return delayBuffer.getReadPointer(channel);
+}
+
+template <typename SampleType>
+int DelayLineWithSampleAccess<SampleType>::getWritePosition(int channel) const
+{
+    return writePosition[static_cast<size_t>(channel)];
+}
+
+template <typename SampleType>
+void DelayLineWithSampleAccess<SampleType>::readBlock(int channel, float delaySamples,
+                                                      SampleType* dest, int count)
+{
+    // The same clamps and centring as interpolate(); the delay holds for the
+    // whole block, so the weights (or the allpass coefficient) do as well
+    const float maxDelay = (float) (numSamples - (interpolation == DelayInterpolation::Lagrange3 ? 3
+                                                : interpolation == DelayInterpolation::Thiran    ? 2 : 1));
+    delaySamples = juce::jlimit(1.0f, maxDelay, delaySamples);
+
+    int delayInt    = (int) std::floor(delaySamples);
+    SampleType frac = (SampleType) (delaySamples - (float) delayInt);
+
+    if (interpolation == DelayInterpolation::Lagrange3 && delayInt >= 2)
+    {
+        --delayInt;
+        frac += (SampleType) 1;
+    }
+    else if (interpolation == DelayInterpolation::Thiran && frac < (SampleType) 0.618 && delayInt >= 2)
+    {
+        --delayInt;
+        frac += (SampleType) 1;
+    }
+
+    const SampleType* ring = delayBuffer.getReadPointer(channel);
+
+    // Newest sample each output reads; the older ones sit just before it
+    int start = (writePosition[(size_t) channel] + 1 - delayInt) % numSamples;
+    if (start < 0)
+        start += numSamples;
+
+    auto before = [&] (int m) { const int idx = start - m; return ring[idx < 0 ? idx + numSamples : idx]; };
+
+    // The span is contiguous but for at most one wrap
+    const int firstPart = std::min(count, numSamples - start);
+    std::copy(ring + start, ring + start + firstPart, dest);
+    std::copy(ring, ring + (count - firstPart), dest + firstPart);
+
+    switch (interpolation)
+    {
+        case DelayInterpolation::Lagrange3:
+        {
+            const SampleType d1 = frac - (SampleType) 1;
+            const SampleType d2 = frac - (SampleType) 2;
+            const SampleType d3 = frac - (SampleType) 3;
+
+            const SampleType c1 = -d1 * d2 * d3 / (SampleType) 6;
+            const SampleType c2 =  frac * d2 * d3 * (SampleType) 0.5;
+            const SampleType c3 = -frac * d1 * d3 * (SampleType) 0.5;
+            const SampleType c4 =  frac * d1 * d2 / (SampleType) 6;
+
+            SampleType p1 = before(1), p2 = before(2), p3 = before(3);
+
+            for (int i = 0; i < count; ++i)
+            {
+                const SampleType s1 = dest[i];
+                dest[i] = s1 * c1 + p1 * c2 + p2 * c3 + p3 * c4;
+                p3 = p2;
+                p2 = p1;
+                p1 = s1;
+            }
+
+            return;
+        }
+
+        case DelayInterpolation::Thiran:
+        {
+            // A whole-sample delay reads straight through, as interpolate()
+            // does, and leaves the allpass state alone
+            if (frac == (SampleType) 0)
+                return;
+
+            const SampleType alpha = ((SampleType) 1 - frac) / ((SampleType) 1 + frac);
+
+            SampleType previous = before(1);
+            SampleType state    = v[(size_t) channel];
+
+            for (int i = 0; i < count; ++i)
+            {
+                const SampleType s1 = dest[i];
+                state    = previous + alpha * (s1 - state);
+                dest[i]  = state;
+                previous = s1;
+            }
+
+            v[(size_t) channel] = state;
+            return;
+        }
+
+        case DelayInterpolation::Linear:
+        default:
+            break;
+    }
+
+    SampleType previous = before(1);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const SampleType s1 = dest[i];
+        dest[i] = s1 + frac * (previous - s1);
+        previous = s1;
+    }
+}
+
+template <typename SampleType>
+void DelayLineWithSampleAccess<SampleType>::pushBlock(int channel, const SampleType* source, int count)
+{
+    const size_t ch = static_cast<size_t>(channel);
+    SampleType* ring = delayBuffer.getWritePointer(channel);
+
+    const int firstPart = std::min(count, numSamples - writePosition[ch]);
+    std::copy(source, source + firstPart, ring + writePosition[ch]);
+    std::copy(source + firstPart, source + count, ring);
+
+    writePosition[ch] = (writePosition[ch] + count) % numSamples;
+}
+
 template <typename SampleType>
 void DelayLineWithSampleAccess<SampleType>::prepare(const juce::dsp::ProcessSpec& spec)
 {
     jassert(spec.numChannels > 0);
 
     delayBuffer.setSize((int) spec.numChannels, totalSize, false, false, true);
+    numSamples = delayBuffer.getNumSamples();
 
     writePosition.resize(spec.numChannels);
     readPosition.resize(spec.numChannels);
@@ -23,6 +23,12 @@ Delay based on juce::dsp::DelayLine, but allows access to the underlying buffer
 #endif
 // #include "Utilities.h"
 
+// How readFractional() reads between samples. Linear is cheapest but dulls
+// the top end while the delay moves; Lagrange3 is a 4-point FIR, flat well
+// past the linear rolloff; Thiran is a first-order allpass - flat magnitude,
+// but stateful, so only for lines read once per sample per channel.
+enum class DelayInterpolation { Linear, Lagrange3, Thiran };
+
 template <typename SampleType>
 class DelayLineWithSampleAccess
 {
@@ -42,18 +48,41 @@ public:
     void setDelay(int newLength);
     void setDelay(float newDelayInSamples);
 
-    SampleType readFractional(int channel, float delayInSamples) const;
+    SampleType readFractional(int channel, float delayInSamples);
+
+    void setInterpolation(DelayInterpolation newInterpolation);
+    DelayInterpolation getInterpolation() const { return interpolation; }
     
     void setSize(const int numChannels, const int newSize);
+
+    // Takes effect at the next prepare(), which keeps the current allocation
+    // whenever it is already big enough
+    void setMaximumDelayInSamples(int maximumDelayInSamples);
     
     int getNumSamples() const;
+
+    // Raw ring access for block reads: the next pushSample() on channel
+    // writes at getWritePosition(channel)
+    const SampleType* getReadPointer(int channel) const;
+    int getWritePosition(int channel) const;
+
+    // Block equivalents of numSamples pushSample() calls, and of the
+    // readFractional() calls that would be interleaved with them at a fixed
+    // delay. readBlock() must come first, and is only exact when the read
+    // never reaches this block's writes: delaySamples >= numSamples + 2.
+    void readBlock(int channel, float delaySamples, SampleType* dest, int numSamples);
+    void pushBlock(int channel, const SampleType* source, int numSamples);
     
     void prepare(const juce::dsp::ProcessSpec& spec);
     
     void reset();
 private:
+    // readFractional() as if the write position were writePos
+    SampleType interpolate(int channel, int writePos, float delaySamples);
+
     juce::AudioBuffer<SampleType> delayBuffer;
-    std::vector<SampleType> v;
+    DelayInterpolation interpolation = DelayInterpolation::Linear;
+    std::vector<SampleType> v;   // Thiran allpass state per channel
     int numSamples = 0;
     std::vector<int> writePosition, readPosition;
     SampleType delay = 0.0, delayFrac = 0.0;
@@ -593,6 +593,18 @@ void DatorroHall::setParameters(const ReverbProcessorParameters& params)
 
 //==============================================================================
 
+void DatorroHall::setInterpolation(DelayInterpolation newInterpolation)
+{
+    // The early-reflection lines are read at several taps per sample, so
+    // they stay linear
+    for (auto* line : { &preDelayL, &preDelayR,
+                        &tankDelayL1, &tankDelayL2, &tankDelayL3, &tankDelayL4,
+                        &tankDelayR1, &tankDelayR2, &tankDelayR3, &tankDelayR4 })
+        line->setInterpolation(newInterpolation);
+}
+
+//==============================================================================
+
 void DatorroHall::applyFDNScattering(const float in[4], float (&out)[4]) const
 {
     // A 4x4 Householder matrix:
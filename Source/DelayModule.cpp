@@ -15,10 +15,57 @@
 #include "DelayModule.h"
 
 DelayModule::DelayModule(const juce::String& id, juce::AudioProcessorValueTreeState& apvts)
-    : moduleID(id), state(apvts) {}
+    : moduleID(id), state(apvts)
+{
+    rebuildParamIDs();
+}
+
+void DelayModule::rebuildParamIDs()
+{
+    pNumTaps = moduleID + ".delayTaps";
+
+    for (int t = 0; t < BasicDelay::kMaxTaps; ++t)
+    {
+        const juce::String tap = moduleID + ".delayTap" + juce::String(t + 1);
+        pTapTime[t]    = tap + "Time";
+        pTapLevel[t]   = tap + "Level";
+        pTapPan[t]     = tap + "Pan";
+        pTapLowpass[t] = tap + "Lowpass";
+    }
+}
 
 void DelayModule::prepare(const juce::dsp::ProcessSpec& spec)
 {
+    // Lines long enough for the longest delay the parameters can reach: the
+    // top of the free-running range, or the longest division at the slowest
+    // tempo (host tempos are held to the same range in process()), times the
+    // longest tap. BasicDelay caps that at kMaximumDelayCapMs.
+    auto* timeParam = state.getParameter(moduleID + ".delayTime");
+    auto* bpmParam  = state.getParameter(moduleID + ".delayBpm");
+    auto* tapParam  = state.getParameter(pTapTime[0]);
+
+    // Prepared before its slot ID was set? The ranges would be the default
+    // {0, 1} - no tempo to work from at all
+    jassert(timeParam != nullptr && bpmParam != nullptr && tapParam != nullptr);
+
+    if (timeParam != nullptr && bpmParam != nullptr && tapParam != nullptr)
+    {
+        const auto timeRange = state.getParameterRange(moduleID + ".delayTime");
+        bpmRange = state.getParameterRange(moduleID + ".delayBpm").getRange();
+
+        // Every tap shares the first one's range
+        const float longestTap = juce::jlimit(1.0f, BasicDelay::kMaxTapRatio,
+                                              state.getParameterRange(pTapTime[0]).end);
+
+        const float longestHeadMs = juce::jmax(timeRange.end, BasicDelay::longestDivisionMs(bpmRange.getStart()));
+        delay.setMaximumDelayMs(longestHeadMs * longestTap);
+    }
+    else
+    {
+        // Fixed size, and bpmRange left as it was
+        delay.setMaximumDelayMs(BasicDelay::kDefaultMaximumDelayMs);
+    }
+
     delay.prepare(spec);
 }
 
@@ -41,6 +88,8 @@ void DelayModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& /*
                     bpm = static_cast<float>(*hostBpm);
         }
 
+        bpm = bpmRange.clipValue(bpm);
+
         // Map the APVTS int index to BasicDelay::SyncDivision.
         // The APVTS parameter uses 14 divisions (includes 1/32, dotted 1/16,
         // triplet 1/16).  BasicDelay::SyncDivision covers 11 of those.
@@ -102,6 +151,19 @@ void DelayModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& /*
     delay.setPan         (*state.getRawParameterValue(moduleID + ".delayPan"));
     delay.setLowpassFreq (*state.getRawParameterValue(moduleID + ".delayLowpass"));
     delay.setHighpassFreq(*state.getRawParameterValue(moduleID + ".delayHighpass"));
+    delay.setInterpolation(static_cast<DelayInterpolation>(
+        static_cast<int>(state.getRawParameterValue(moduleID + ".interpolation")->load())));
+
+    // Extra read heads
+    const int numTaps = static_cast<int>(state.getRawParameterValue(pNumTaps)->load());
+    delay.setNumTaps(numTaps);
+
+    for (int t = 0; t < numTaps; ++t)
+        delay.setTap(t,
+                     state.getRawParameterValue(pTapTime[t])   ->load(),
+                     state.getRawParameterValue(pTapLevel[t])  ->load(),
+                     state.getRawParameterValue(pTapPan[t])    ->load(),
+                     state.getRawParameterValue(pTapLowpass[t])->load());
 
     if (*state.getRawParameterValue(moduleID + ".enabled") > 0.5f)
         delay.processBlock(buffer);
@@ -109,7 +171,7 @@ void DelayModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& /*
 
 std::vector<juce::String> DelayModule::getUsedParameters() const
 {
-    return {
+    std::vector<juce::String> params {
         "mix",
         "delayTime",
         "feedback",
@@ -119,11 +181,19 @@ std::vector<juce::String> DelayModule::getUsedParameters() const
         "delayMode",
         "delayPan",
         "delayLowpass",
-        "delayHighpass"
+        "delayHighpass",
+        "interpolation",
+        "delayTaps"
     };
+
+    for (int t = 1; t <= BasicDelay::kMaxTaps; ++t)
+        for (auto* suffix : { "Time", "Level", "Pan", "Lowpass" })
+            params.push_back("delayTap" + juce::String(t) + suffix);
+
+    return params;
 }
 
-void DelayModule::setID(juce::String& newID)              { moduleID = newID; }
+void DelayModule::setID(juce::String& newID)              { moduleID = newID; rebuildParamIDs(); }
 void DelayModule::setPlayHead(juce::AudioPlayHead* ph)    { playHead = ph; }
 juce::String DelayModule::getID()   const                 { return moduleID; }
 juce::String DelayModule::getType() const                 { return "Delay"; }
\ No newline at end of file
@@ -33,4 +33,12 @@ private:
     juce::AudioProcessorValueTreeState& state;
     juce::AudioPlayHead *playHead = nullptr;
     BasicDelay delay;
+    juce::Range<float> bpmRange { 20.0f, 300.0f };   // from the delayBpm parameter
+
+    // Pre-built tap parameter IDs - 33 per block would otherwise each allocate
+    juce::String pNumTaps;
+    juce::String pTapTime[BasicDelay::kMaxTaps], pTapLevel[BasicDelay::kMaxTaps],
+                 pTapPan[BasicDelay::kMaxTaps],  pTapLowpass[BasicDelay::kMaxTaps];
+
+    void rebuildParamIDs();
 };
\ No newline at end of file
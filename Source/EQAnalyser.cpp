@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    EQAnalyser.cpp
+    Background FFT for the EQ display
+
+  ==============================================================================
+*/
+
+#include "EQAnalyser.h"
+
+namespace
+{
+    // Peak hold falls back by this much per frame
+    constexpr float kDecay = 0.78f;
+
+    // How often the thread wakes to drain the FIFO
+    constexpr int kPollMs = 10;
+}
+
+EQAnalyser::EQAnalyser(EQModule& moduleToAnalyse)
+    : juce::Thread("EQ Analyser"),
+      mod(moduleToAnalyse)
+{
+}
+
+EQAnalyser::~EQAnalyser()
+{
+    stop();
+}
+
+void EQAnalyser::start(int decimation)
+{
+    if (isThreadRunning())
+        return;
+
+    mod.setAnalysisDecimation(decimation);
+
+    // Frames keep coming at the same rate whatever the decimation - more
+    // overlap instead
+    hopSize = fftSize / mod.getAnalysisDecimation();
+
+    // Whatever was queued before the last stop() is stale
+    while (mod.readAnalysisSamples(readBlock.data(), fftSize) > 0) {}
+
+    std::fill(history.begin(), history.end(), 0.0f);
+    std::fill(smoothed.begin(), smoothed.end(), 0.0f);
+    historyPos = 0;
+    sinceLastFrame = 0;
+
+    mod.setAnalysisEnabled(true);
+    startThread(juce::Thread::Priority::low);
+}
+
+void EQAnalyser::stop()
+{
+    mod.setAnalysisEnabled(false);
+    stopThread(1000);
+}
+
+bool EQAnalyser::getSpectrum(std::vector<float>& dest, double& analysisSampleRate)
+{
+    const juce::SpinLock::ScopedLockType sl(spectrumLock);
+
+    if (!spectrumPending)
+        return false;
+
+    dest = published;
+    analysisSampleRate = publishedSampleRate;
+    spectrumPending = false;
+    return true;
+}
+
+void EQAnalyser::run()
+{
+    while (!threadShouldExit())
+    {
+        int numRead;
+
+        while ((numRead = mod.readAnalysisSamples(readBlock.data(), hopSize - sinceLastFrame)) > 0)
+        {
+            for (int i = 0; i < numRead; ++i)
+            {
+                history[(size_t) historyPos] = readBlock[(size_t) i];
+                historyPos = (historyPos + 1) & (fftSize - 1);
+            }
+
+            sinceLastFrame += numRead;
+
+            if (sinceLastFrame >= hopSize)
+            {
+                computeFrame();
+                sinceLastFrame = 0;
+            }
+
+            if (threadShouldExit())
+                return;
+        }
+
+        wait(kPollMs);
+    }
+}
+
+void EQAnalyser::computeFrame()
+{
+    // Oldest sample first
+    const int tail = fftSize - historyPos;
+    std::copy_n(history.data() + historyPos, tail, fftData.data());
+    std::copy_n(history.data(), historyPos, fftData.data() + tail);
+
+    window.multiplyWithWindowingTable(fftData.data(), (size_t) fftSize);
+    fft.performFrequencyOnlyForwardTransform(fftData.data());
+
+    for (int i = 0; i < numBins; i++)
+    {
+        const float magnitude = fftData[(size_t) i] / (float) fftSize;
+        smoothed[(size_t) i] = std::max(magnitude, smoothed[(size_t) i] * kDecay);
+
+        // The logs happen here rather than in every repaint
+        smoothedDb[(size_t) i] = juce::Decibels::gainToDecibels(smoothed[(size_t) i], -100.0f);
+    }
+
+    const juce::SpinLock::ScopedLockType sl(spectrumLock);
+    std::copy(smoothedDb.begin(), smoothedDb.end(), published.begin());
+    publishedSampleRate = mod.getSampleRate() / mod.getAnalysisDecimation();
+    spectrumPending = true;
+}
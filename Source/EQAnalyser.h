@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    EQAnalyser.h
+    Background FFT for the EQ display
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_core/juce_core.h>
+  #include <juce_dsp/juce_dsp.h>
+#endif
+
+#include "EQModule.h"
+
+// Drains an EQModule's analysis FIFO on its own thread and turns it into a
+// peak-held magnitude spectrum. Runs only between start() and stop() - the
+// display calls them as it's shown and hidden - and the module's tap is
+// switched on for exactly that span.
+class EQAnalyser : private juce::Thread
+{
+public:
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize  = 1 << fftOrder;
+    static constexpr int numBins  = fftSize / 2;
+
+    explicit EQAnalyser(EQModule& moduleToAnalyse);
+    ~EQAnalyser() override;
+
+    // Message thread
+    void start(int decimation = 1);
+    void stop();
+    bool isRunning() const { return isThreadRunning(); }
+
+    // Copies the latest spectrum (numBins magnitudes in dB, floored at
+    // -100) into dest if a new one has been published since the last call. analysisSampleRate is
+    // what bin k's frequency, k * analysisSampleRate / fftSize, is relative to.
+    bool getSpectrum(std::vector<float>& dest, double& analysisSampleRate);
+
+private:
+    void run() override;
+    void computeFrame();
+
+    EQModule& mod;
+
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { (size_t) fftSize, juce::dsp::WindowingFunction<float>::hann };
+
+    // Last fftSize samples, a ring; a frame is computed every hopSize new ones
+    std::vector<float> history   = std::vector<float>((size_t) fftSize, 0.0f);
+    std::vector<float> readBlock = std::vector<float>((size_t) fftSize, 0.0f);
+    std::vector<float> fftData   = std::vector<float>((size_t) (2 * fftSize), 0.0f);
+    std::vector<float> smoothed  = std::vector<float>((size_t) numBins, 0.0f);
+    std::vector<float> smoothedDb = std::vector<float>((size_t) numBins, -100.0f);
+    int historyPos = 0;
+    int sinceLastFrame = 0;
+    int hopSize = fftSize;
+
+    // Handed to the message thread under the lock - both sides only copy
+    juce::SpinLock spectrumLock;
+    std::vector<float> published = std::vector<float>((size_t) numBins, -100.0f);
+    double publishedSampleRate = 44100.0;
+    bool spectrumPending = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQAnalyser)
+};
@@ -12,163 +12,153 @@
 
 EQDisplayComponent::EQDisplayComponent(EQModule& modRef)
     : mod(modRef),
-    fft(fftOrder),
-    window(fftSize, juce::dsp::WindowingFunction<float>::hann)
+    analyser(modRef)
 {
     startTimerHz(60);
-    smoothedFFT.resize(fftSize / 2, -100.0f); // or lowest dB value
+    spectrumDb.resize(EQAnalyser::numBins, -100.0f);
+    analysisSampleRate = mod.getSampleRate();
 }
 
-void EQDisplayComponent::pushSamples(const float* samples, int numSamples)
+EQDisplayComponent::~EQDisplayComponent()
 {
-    for (int i = 0; i < numSamples; i++)
-    {
-        fifo[fifoIndex++] = samples[i];
-
-        if (fifoIndex == fftSize)
-        {
-            memcpy(fftData, fifo, sizeof(float) * fftSize);
-            ready = true;
-            fifoIndex = 0;
-        }
-    }
+    analyser.stop();
 }
 
-void EQDisplayComponent::timerCallback()
+void EQDisplayComponent::visibilityChanged()
 {
-    if (ready)
-    {
-        drawNextFrame();
-        ready = false;
-        repaint();
-    }
+    updateAnalyserState();
 }
 
-void EQDisplayComponent::drawNextFrame()
+void EQDisplayComponent::parentHierarchyChanged()
 {
-    window.multiplyWithWindowingTable(fftData, fftSize);
-    fft.performFrequencyOnlyForwardTransform(fftData);
-
-    for (int i = 0; i < fftSize / 2; i++) {
-        fftData[i] /= (float)fftSize;
-
-        float newValue = fftData[i];
-
-        float decay = 0.78f;
+    updateAnalyserState();
+}
 
-        smoothedFFT[i] = std::max(newValue, smoothedFFT[i] * decay);
-    }
+void EQDisplayComponent::updateAnalyserState()
+{
+    if (isShowing())
+        analyser.start();
+    else
+        analyser.stop();
 }
 
-void EQDisplayComponent::paint(juce::Graphics& g)
+void EQDisplayComponent::timerCallback()
 {
-    auto bounds = getLocalBounds();
+    bool changed = false;
 
-    g.fillAll(juce::Colours::black);
+    if (analyser.getSpectrum(spectrumDb, analysisSampleRate))
+    {
+        if (analysisSampleRate != binTapsSampleRate)
+            rebuildBinTaps();
 
-    // ==============================
-    // 1) DRAW GRID (optional)
-    // ==============================
-    g.setColour(juce::Colours::dimgrey);
+        rebuildSpectrumPath();
+        changed = true;
+    }
 
-    for (float freq : { 20.f, 50.f, 100.f, 200.f, 500.f,
-        1000.f, 2000.f, 5000.f, 10000.f, 20000.f })
+    const int version = mod.getResponseVersion();
+
+    if (version != responseVersion)
     {
-        float normX = juce::mapFromLog10(freq, 20.f, 20000.f);
-        int x = normX * bounds.getWidth();
-        g.drawVerticalLine(x, 0, bounds.getHeight());
+        responseVersion = version;
+        rebuildResponsePath();
+        changed = true;
     }
 
-    // ==============================
-    // 2) DRAW SPECTRUM (behind)
-    // ==============================
-
-    juce::Path spectrumPath;
-    spectrumPath.startNewSubPath(0, bounds.getBottom());
+    if (changed)
+        repaint();
+}
 
-    int width = bounds.getWidth();
+void EQDisplayComponent::resized()
+{
+    const int width = getWidth();
 
     float minFreq = 20.0f;
     float maxFreq = 20000.0f;
-    float sampleRate = mod.getSampleRate();
+
+    columnFreqs.resize((size_t) juce::jmax(0, width));
 
     for (int x = 0; x < width; x++)
-    {
-        float normX = x / (float)width;
+        columnFreqs[(size_t) x] = minFreq * std::pow(maxFreq / minFreq, x / (float)width);
 
-        float freq = minFreq * std::pow(maxFreq / minFreq, normX);
+    gridX.clear();
 
-        float bin = freq * fftSize / sampleRate;
+    for (float freq : { 20.f, 50.f, 100.f, 200.f, 500.f,
+        1000.f, 2000.f, 5000.f, 10000.f, 20000.f })
+        gridX.push_back(juce::mapFromLog10(freq, minFreq, maxFreq) * width);
 
-        int center = (int)bin;
+    responseMagnitudes.resize(columnFreqs.size());
 
-        float mag = 0.0f;
-        //int radius = (int) juce::jmap(freq, 20.0f, 20000.0f, 6.0f, 2.0f);
-        int radius = 1;
+    rebuildBinTaps();
+    rebuildSpectrumPath();
+    rebuildResponsePath();
+}
 
-        for (int k = -radius; k <= radius; k++)
-        {
-            int idx = juce::jlimit(
-                0,
-                fftSize / 2,
-                center + k);
+void EQDisplayComponent::rebuildBinTaps()
+{
+    binTapsSampleRate = analysisSampleRate;
+    binTaps.resize(columnFreqs.size());
 
-            mag += smoothedFFT[idx];
-        }
+    for (size_t x = 0; x < columnFreqs.size(); x++)
+    {
+        float bin = columnFreqs[x] * fftSize / (float)analysisSampleRate;
 
-        mag /= (2 * radius + 1);
+        int center = (int)bin;
+        float frac = bin - center;
 
-        float magNext = 0.0f;
+        // avg(center - 1 .. center + 1) * (1 - frac) + avg(center .. center + 2) * frac
+        auto& tap = binTaps[x];
+        const float weights[4] = { (1.0f - frac) / 3.0f, 1.0f / 3.0f, 1.0f / 3.0f, frac / 3.0f };
 
-        for (int k = -radius; k <= radius; k++)
+        for (int k = 0; k < 4; k++)
         {
-            int idx = juce::jlimit(
-                0,
-                fftSize / 2,
-                center + 1 + k);
-
-            magNext += smoothedFFT[idx];
+            tap.bin[k] = juce::jlimit(0, EQAnalyser::numBins - 1, center - 1 + k);
+            tap.weight[k] = weights[k];
         }
+    }
+}
 
-        magNext /= (2 * radius + 1);
+void EQDisplayComponent::rebuildSpectrumPath()
+{
+    auto bounds = getLocalBounds();
 
-        float frac = bin - center;
+    spectrumPath.clear();
+    spectrumPath.startNewSubPath(0, bounds.getBottom());
+
+    for (size_t x = 0; x < binTaps.size(); x++)
+    {
+        const auto& tap = binTaps[x];
 
-        float finalMag =
-            mag * (1 - frac) + magNext * frac;
+        float level = 0.0f;
 
-        float level = juce::Decibels::gainToDecibels(
-            finalMag, -100.0f);
+        for (int k = 0; k < 4; k++)
+            level += tap.weight[k] * spectrumDb[(size_t) tap.bin[k]];
 
         float y = juce::jmap(level,
             -80.0f, 10.0f,
             (float)bounds.getBottom(),
             (float)bounds.getY());
 
-        spectrumPath.lineTo(x, y);
+        spectrumPath.lineTo((float)x, y);
     }
 
     spectrumPath.lineTo(bounds.getWidth(), bounds.getBottom());
     spectrumPath.closeSubPath();
+}
 
-    g.setColour(juce::Colours::yellow.withAlpha(0.4f));
-    g.fillPath(spectrumPath);
+void EQDisplayComponent::rebuildResponsePath()
+{
+    auto bounds = getLocalBounds();
 
-    // ==============================
-    // 3) DRAW EQ CURVE (ON TOP)
-    // ==============================
+    responsePath.clear();
 
-    juce::Path eqPath;
+    if (columnFreqs.empty())
+        return;
 
-    for (int x = 0; x < width; x++)
-    {
-        float freq = juce::mapToLog10(
-            (float)x / (float)width,
-            20.0f,
-            20000.0f);
+    mod.getMagnitudesForFrequencies(columnFreqs.data(), responseMagnitudes.data(), (int)columnFreqs.size());
 
-        float mag = mod.getMagnitudeForFrequency(freq);
-        float db = juce::Decibels::gainToDecibels(mag);
+    for (size_t x = 0; x < responseMagnitudes.size(); x++)
+    {
+        float db = juce::Decibels::gainToDecibels(responseMagnitudes[x]);
 
         float y = juce::jmap(db,
             -24.0f, 24.0f,
@@ -176,11 +166,35 @@ void EQDisplayComponent::paint(juce::Graphics& g)
             (float)bounds.getY());
 
         if (x == 0)
-            eqPath.startNewSubPath(x, y);
+            responsePath.startNewSubPath((float)x, y);
         else
-            eqPath.lineTo(x, y);
+            responsePath.lineTo((float)x, y);
     }
+}
+
+void EQDisplayComponent::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds();
+
+    g.fillAll(juce::Colours::black);
+
+    // ==============================
+    // 1) DRAW GRID (optional)
+    // ==============================
+    g.setColour(juce::Colours::dimgrey);
+
+    for (float x : gridX)
+        g.drawVerticalLine((int)x, 0, bounds.getHeight());
 
+    // ==============================
+    // 2) DRAW SPECTRUM (behind)
+    // ==============================
+    g.setColour(juce::Colours::yellow.withAlpha(0.4f));
+    g.fillPath(spectrumPath);
+
+    // ==============================
+    // 3) DRAW EQ CURVE (ON TOP)
+    // ==============================
     g.setColour(juce::Colours::cyan);
-    g.strokePath(eqPath, juce::PathStrokeType(2.5f));
+    g.strokePath(responsePath, juce::PathStrokeType(2.5f));
 }
\ No newline at end of file
@@ -28,36 +28,65 @@
 #endif
 
 #include "EQModule.h"
+#include "EQAnalyser.h"
 
 class EQDisplayComponent : public juce::Component,
     private juce::Timer
 {
 public:
     EQDisplayComponent(EQModule& modRef);
-
-    void pushSamples(const float* samples, int numSamples);
+    ~EQDisplayComponent() override;
 
     void paint(juce::Graphics&) override;
+    void resized() override;
+
+    // The analyser only runs while the display is on screen
+    void visibilityChanged() override;
+    void parentHierarchyChanged() override;
 
 private:
     EQModule& mod;
 
     // ===== FFT =====
-    static constexpr int fftOrder = 11;
-    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int fftSize = EQAnalyser::fftSize;
+
+    EQAnalyser analyser;
+
+    std::vector<float> spectrumDb;
+    double analysisSampleRate = 44100.0;
 
-    juce::dsp::FFT fft;
-    juce::dsp::WindowingFunction<float> window;
+    // ===== Cached geometry =====
+    // Everything per pixel column is worked out in resized() (and the bin
+    // table again if the analysis rate changes), the paths only when their
+    // data changes - paint() just draws.
 
-    float fifo[fftSize] = { 0.0f };
-    float fftData[2 * fftSize] = { 0.0f };
-    int fifoIndex = 0;
-    bool ready = false;
+    // Log-spaced 20 Hz - 20 kHz, one per column
+    std::vector<float> columnFreqs;
+    std::vector<float> gridX;
 
-    std::vector<float> smoothedFFT;
+    // A column's spectrum level: the 3-bin averages either side of its
+    // frequency, interpolated - as four weighted bins
+    struct BinTap
+    {
+        int bin[4];
+        float weight[4];
+    };
+
+    std::vector<BinTap> binTaps;
+    double binTapsSampleRate = 0.0;
+
+    std::vector<float> responseMagnitudes;
+    int responseVersion = -1;
+
+    juce::Path spectrumPath;
+    juce::Path responsePath;
 
     void timerCallback() override;
-    void drawNextFrame();
+    void updateAnalyserState();
+
+    void rebuildBinTaps();
+    void rebuildSpectrumPath();
+    void rebuildResponsePath();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQDisplayComponent)
 };
\ No newline at end of file
@@ -39,20 +39,81 @@ void EQModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& /*mid
     if (*state.getRawParameterValue(moduleID + ".enabled") > 0.5f)
         eq.processBlock(buffer);
 
+    if (analysisEnabled.load(std::memory_order_acquire))
+        pushAnalysisSamples(buffer);
+}
+
+void EQModule::pushAnalysisSamples(const juce::AudioBuffer<float>& buffer)
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples  = buffer.getNumSamples();
+
+    if (numChannels == 0)
+        return;
 
+    const float* left  = buffer.getReadPointer(0);
+    const float* right = buffer.getReadPointer(juce::jmin(1, numChannels - 1));
 
-    auto* samples = buffer.getReadPointer(0);
+    const int factor  = analysisDecimation.load(std::memory_order_relaxed);
+    const float scale = 0.5f / (float) factor;
 
-    for (int i = 0; i < buffer.getNumSamples(); i++)
+    int start1, size1, start2, size2;
+    analysisFifo.prepareToWrite((decimationCount + numSamples) / factor, start1, size1, start2, size2);
+
+    int written = 0;
+
+    for (int i = 0; i < numSamples; i++)
     {
-        fftBuffer[fftIndex++] = samples[i];
+        decimationSum += left[i] + right[i];
+
+        if (++decimationCount < factor)
+            continue;
+
+        const float value = decimationSum * scale;
+        decimationSum   = 0.0f;
+        decimationCount = 0;
 
-        if (fftIndex == fftSize)
-        {
-            fftReady = true;
-            fftIndex = 0;
-        }
+        if (written < size1)
+            analysisData[(size_t) (start1 + written)] = value;
+        else if (written < size1 + size2)
+            analysisData[(size_t) (start2 + written - size1)] = value;
+        else
+            break;
+
+        written++;
     }
+
+    analysisFifo.finishedWrite(written);
+}
+
+void EQModule::setAnalysisEnabled(bool shouldBeEnabled)
+{
+    analysisEnabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+void EQModule::setAnalysisDecimation(int factor)
+{
+    analysisDecimation.store(juce::jlimit(1, 4, factor), std::memory_order_relaxed);
+}
+
+int EQModule::getAnalysisDecimation() const
+{
+    return analysisDecimation.load(std::memory_order_relaxed);
+}
+
+int EQModule::readAnalysisSamples(float* dest, int maxSamples)
+{
+    int start1, size1, start2, size2;
+    analysisFifo.prepareToRead(maxSamples, start1, size1, start2, size2);
+
+    if (size1 > 0)
+        std::copy_n(analysisData.data() + start1, size1, dest);
+
+    if (size2 > 0)
+        std::copy_n(analysisData.data() + start2, size2, dest + size1);
+
+    analysisFifo.finishedRead(size1 + size2);
+    return size1 + size2;
 }
 
 std::vector<juce::String> EQModule::getUsedParameters() const
@@ -70,6 +131,14 @@ float EQModule::getMagnitudeForFrequency(float freq) {
     return eq.getMagnitudeForFrequency(freq);
 }
 
+void EQModule::getMagnitudesForFrequencies(const float* freqs, float* magnitudes, int num) {
+    eq.getMagnitudesForFrequencies(freqs, magnitudes, num);
+}
+
+int EQModule::getResponseVersion() const {
+    return eq.getResponseVersion();
+}
+
 float EQModule::getSampleRate() {
     return eq.sampleRate;
 }
@@ -42,18 +42,45 @@ public:
     void setID(juce::String& newID) override;
     juce::String getType() const override;
     float getMagnitudeForFrequency(float freq);
+    void getMagnitudesForFrequencies(const float* freqs, float* magnitudes, int num);
+    int getResponseVersion() const;
     float getSampleRate();
 
     // EQModule has no playhead dependency, but we keep the base default
-    static constexpr int fftSize = 2048;
 
-    float fftBuffer[fftSize];
-    int fftIndex = 0;
-    bool fftReady = false;
+    // -----------------------------------------------------------------------
+    // Analysis tap - the post-EQ mid signal for the display, through a
+    // lock-free single-producer / single-consumer FIFO (audio thread in,
+    // EQAnalyser's thread out). Off unless a display is showing, and then
+    // the audio thread's only cost is the copy.
+    // -----------------------------------------------------------------------
+    static constexpr int analysisFifoSize = 8192;
 
+    void setAnalysisEnabled(bool shouldBeEnabled);
+
+    // Average every factor (1, 2 or 4) samples before queueing them - finer
+    // low-end resolution from the same FFT size. Set it before enabling.
+    void setAnalysisDecimation(int factor);
+    int getAnalysisDecimation() const;
+
+    // Consumer side: moves up to maxSamples into dest, returns how many
+    int readAnalysisSamples(float* dest, int maxSamples);
 
 private:
     juce::String moduleID;
     juce::AudioProcessorValueTreeState& state;
     BasicEQ eq;
+
+    // Producer side, audio thread. A full FIFO drops the rest of the block -
+    // the consumer has fallen behind and the display won't miss it.
+    void pushAnalysisSamples(const juce::AudioBuffer<float>& buffer);
+
+    juce::AbstractFifo analysisFifo { analysisFifoSize };
+    std::vector<float> analysisData = std::vector<float>((size_t) analysisFifoSize, 0.0f);
+
+    std::atomic<bool> analysisEnabled    { false };
+    std::atomic<int>  analysisDecimation { 1 };
+
+    float decimationSum   = 0.0f;
+    int   decimationCount = 0;
 };
@@ -21,7 +21,6 @@ EQModuleSlotEditor::EQModuleSlotEditor(
         state)
 {
     buildEditor(info);
-    startTimerHz(60);
 }
 
 void EQModuleSlotEditor::buildEditor(const SlotInfo& info)
@@ -173,14 +172,3 @@ void EQModuleSlotEditor::layoutEditor(juce::Rectangle<int>& r)
             a.removeFromTop(25));
     }
 }
-
-void EQModuleSlotEditor::timerCallback()
-{
-    if (mod->fftReady)
-    {
-        display->pushSamples(mod->fftBuffer,
-            mod->fftSize);
-
-        mod->fftReady = false;
-    }
-}
\ No newline at end of file
@@ -14,7 +14,7 @@
 #include "EQModule.h"
 #include "EQDisplayComponent.h"
 
-class EQModuleSlotEditor : public BaseModuleSlotEditor, private juce::Timer
+class EQModuleSlotEditor : public BaseModuleSlotEditor
 {
 public:
 
@@ -72,6 +72,4 @@ private:
     EQModule* mod;
     std::unique_ptr<EQDisplayComponent> display;
 
-    void timerCallback() override;
-
 };
\ No newline at end of file
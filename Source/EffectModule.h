@@ -39,5 +39,23 @@ public:
     virtual void setID(juce::String& newID) = 0;
     virtual void setPlayHead(juce::AudioPlayHead* playhead) {}
 
+    // Samples the module's output trails its input by; the processor adds
+    // these up along each chain and reports the total to the host
+    virtual int getLatencySamples() const { return 0; }
+
+    // Called on the audio thread at the top of every block, before any module
+    // processes. A module whose latency follows its parameters applies them
+    // here, so getLatencySamples() holds for the whole block.
+    virtual void updateLatency() {}
+
+    // The host is rendering offline - a module that would drop work it can't
+    // finish in time may wait for it instead. Not called on the audio thread.
+    virtual void setNonRealtime(bool /*isNonRealtime*/) {}
+
+    // For the slot's meters: modules that reduce gain report the current
+    // reduction (dB, <= 0) and the detector level it's reacting to. Called on
+    // the audio thread after process().
+    virtual bool getGainReduction(float& /*reductionDb*/, float& /*detectorDb*/) const { return false; }
+
     virtual std::vector<juce::String> getUsedParameters() const = 0;
 };
\ No newline at end of file
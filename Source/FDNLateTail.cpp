@@ -0,0 +1,337 @@
+#include "FDNLateTail.h"
+#include "IRAnalysis.h"
+
+namespace
+{
+    // Mutually prime-ish lengths spread over ~30-75 ms - dense enough for a
+    // smooth tail, long enough not to colour it
+    constexpr float kLineLengthsMs[FDNLateTail::kNumLines] = { 31.3f, 37.9f, 41.7f, 46.1f,
+                                                               53.3f, 59.9f, 66.7f, 73.1f };
+
+    // How much of the IR past the handover the level match is measured over
+    constexpr double kMatchWindowSeconds = 0.05;
+
+    float crossoverCoefficient(double sampleRate)
+    {
+        return (float) (1.0 - std::exp(-juce::MathConstants<double>::twoPi * FDNLateTail::kCrossoverHz / sampleRate));
+    }
+
+    // Splits every channel of in into low and high bands with the same
+    // one-pole crossover the network uses (low + high == in)
+    void splitBands(const juce::AudioBuffer<float>& in, float coefficient,
+                    juce::AudioBuffer<float>& low, juce::AudioBuffer<float>& high)
+    {
+        low .setSize(in.getNumChannels(), in.getNumSamples());
+        high.setSize(in.getNumChannels(), in.getNumSamples());
+
+        for (int ch = 0; ch < in.getNumChannels(); ++ch)
+        {
+            const float* x = in.getReadPointer(ch);
+            float* lo = low .getWritePointer(ch);
+            float* hi = high.getWritePointer(ch);
+            float state = 0.0f;
+
+            for (int n = 0; n < in.getNumSamples(); ++n)
+            {
+                state += coefficient * (x[n] - state);
+                lo[n] = state;
+                hi[n] = x[n] - state;
+            }
+        }
+    }
+
+    double energy(const juce::AudioBuffer<float>& buffer, int channel, int start, int numSamples)
+    {
+        const float* x = buffer.getReadPointer(channel, start);
+        double sum = 0.0;
+
+        for (int n = 0; n < numSamples; ++n)
+            sum += (double) x[n] * x[n];
+
+        return sum;
+    }
+}
+
+FDNLateTail::FDNLateTail() = default;
+
+FDNLateTail::Design FDNLateTail::fit(const juce::AudioBuffer<float>& ir, double sr,
+                                     int handoverSample, int fadeSamples)
+{
+    Design d;
+
+    const int window = (int) (kMatchWindowSeconds * sr);
+
+    if (sr <= 0.0 || ir.getNumChannels() == 0 || ir.getNumSamples() < handoverSample + 2 * window)
+        return d;
+
+    // Decay per band, from the handover on - the early part says nothing
+    // about how the late field dies away
+    juce::AudioBuffer<float> low, high;
+    splitBands(ir, crossoverCoefficient(sr), low, high);
+
+    const float broadband = IRAnalysis::estimateDecayTime(IRAnalysis::computeEnergyDecayCurve(ir), sr, handoverSample);
+
+    if (broadband <= 0.0f)
+        return d;
+
+    d.decayLow  = IRAnalysis::estimateDecayTime(IRAnalysis::computeEnergyDecayCurve(low),  sr, handoverSample);
+    d.decayHigh = IRAnalysis::estimateDecayTime(IRAnalysis::computeEnergyDecayCurve(high), sr, handoverSample);
+
+    if (d.decayLow  <= 0.0f) d.decayLow  = broadband;
+    if (d.decayHigh <= 0.0f) d.decayHigh = broadband;
+
+    d.decayLow  = juce::jlimit(0.05f, 30.0f, d.decayLow);
+    d.decayHigh = juce::jlimit(0.05f, 30.0f, d.decayHigh);
+
+    // First arrivals line up with the start of the convolution's fade-out
+    const int shortestLine = (int) (kLineLengthsMs[0] * 0.001f * sr);
+    d.inputDelay = juce::jmax(0, handoverSample - fadeSamples - shortestLine);
+
+    for (auto& channelGains : d.gain)
+        channelGains[0] = channelGains[1] = 1.0f;
+
+    d.active = true;
+
+    // Level match: render the network's own response at unit gain and
+    // compare it with the IR over the same window past the handover
+    FDNLateTail probe;
+    const int blockSize = 1024;
+    probe.prepare({ sr, (juce::uint32) blockSize, 2 }, d.inputDelay);
+    probe.setDesign(d);
+
+    const int renderLength = handoverSample + window;
+    juce::AudioBuffer<float> response(2, renderLength);
+    juce::AudioBuffer<float> input(2, blockSize);
+    response.clear();
+
+    for (int start = 0; start < renderLength; start += blockSize)
+    {
+        const int n = juce::jmin(blockSize, renderLength - start);
+
+        input.clear();
+        if (start == 0)
+            for (int ch = 0; ch < 2; ++ch)
+                input.setSample(ch, 0, 1.0f);
+
+        juce::dsp::AudioBlock<const float> in(input.getArrayOfReadPointers(), 2, (size_t) n);
+        juce::dsp::AudioBlock<float> out(response.getArrayOfWritePointers(), 2, (size_t) start, (size_t) n);
+        probe.process(in, out);
+    }
+
+    juce::AudioBuffer<float> responseLow, responseHigh;
+    splitBands(response, crossoverCoefficient(sr), responseLow, responseHigh);
+
+    // A true-stereo IR reaches each output from both inputs (LL + RL, LR + RR),
+    // as the probe's stereo impulse does
+    const bool trueStereo = ir.getNumChannels() == 4;
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const int irChannel = juce::jmin(ch, ir.getNumChannels() - 1);
+
+        double target[2] = { energy(low,  irChannel, handoverSample, window),
+                             energy(high, irChannel, handoverSample, window) };
+
+        if (trueStereo)
+        {
+            target[0] += energy(low,  ch + 2, handoverSample, window);
+            target[1] += energy(high, ch + 2, handoverSample, window);
+        }
+
+        const double measured[2] = { energy(responseLow,  ch, handoverSample, window),
+                                     energy(responseHigh, ch, handoverSample, window) };
+
+        for (int band = 0; band < 2; ++band)
+            d.gain[ch][band] = measured[band] > 0.0 ? (float) std::sqrt(target[band] / measured[band]) : 0.0f;
+    }
+
+    return d;
+}
+
+void FDNLateTail::prepare(const juce::dsp::ProcessSpec& spec, int maxInputDelay)
+{
+    sampleRate = spec.sampleRate;
+    crossover  = crossoverCoefficient(sampleRate);
+
+    int longest = 1;
+    for (int i = 0; i < kNumLines; ++i)
+    {
+        lineLength[i] = juce::jmax(1, (int) (kLineLengthsMs[i] * 0.001f * sampleRate));
+        longest = juce::jmax(longest, lineLength[i]);
+    }
+
+    const int lineSize = juce::nextPowerOfTwo(longest + 1);
+    lineMask = lineSize - 1;
+
+    for (auto& line : lines)
+        line.assign((size_t) lineSize, 0.0f);
+
+    const int inputSize = juce::nextPowerOfTwo(juce::jmax(0, maxInputDelay) + 1);
+    inputMask = inputSize - 1;
+
+    for (auto& ring : inputRing)
+        ring.assign((size_t) inputSize, 0.0f);
+
+    for (auto& channelGains : outGain)
+        for (auto& g : channelGains)
+            g.reset(sampleRate, kRampSeconds);
+
+    reset();
+}
+
+void FDNLateTail::reset()
+{
+    for (auto& line : lines)
+        std::fill(line.begin(), line.end(), 0.0f);
+
+    for (auto& ring : inputRing)
+        std::fill(ring.begin(), ring.end(), 0.0f);
+
+    std::fill(std::begin(lineLowState), std::end(lineLowState), 0.0f);
+    std::fill(std::begin(outLowState),  std::end(outLowState),  0.0f);
+
+    writePos = 0;
+}
+
+void FDNLateTail::setDesign(const Design& newDesign)
+{
+    const juce::SpinLock::ScopedLockType sl(designLock);
+    pendingDesign = newDesign;
+    designPending = true;
+}
+
+bool FDNLateTail::isSilent() const
+{
+    for (const auto& channelGains : outGain)
+        for (const auto& g : channelGains)
+            if (g.isSmoothing() || g.getCurrentValue() != 0.0f)
+                return false;
+
+    return true;
+}
+
+void FDNLateTail::applyDesign(const Design& d)
+{
+    const bool wasSilent = isSilent();
+
+    if (d.active)
+    {
+        inputDelay = juce::jlimit(0, inputMask, d.inputDelay);
+
+        // Per-pass loss for each line's length, so every path through the
+        // network falls 60 dB in the fitted time
+        for (int i = 0; i < kNumLines; ++i)
+        {
+            lowGain[i]  = (float) std::pow(10.0, -3.0 * lineLength[i] / (d.decayLow  * sampleRate));
+            highGain[i] = (float) std::pow(10.0, -3.0 * lineLength[i] / (d.decayHigh * sampleRate));
+        }
+    }
+
+    // Switched off: the current decay is kept while the output ramps down
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        for (int band = 0; band < 2; ++band)
+        {
+            const float target = d.active ? d.gain[ch][band] : 0.0f;
+
+            if (wasSilent)
+                outGain[ch][band].setCurrentAndTargetValue(target);
+            else
+                outGain[ch][band].setTargetValue(target);
+        }
+    }
+}
+
+bool FDNLateTail::process(const juce::dsp::AudioBlock<const float>& input,
+                          juce::dsp::AudioBlock<float>& output)
+{
+    {
+        const juce::SpinLock::ScopedTryLockType tl(designLock);
+
+        if (tl.isLocked() && designPending)
+        {
+            // Anything left ringing in a silent network is inaudible but would
+            // come back with the new design
+            if (isSilent())
+                reset();
+
+            applyDesign(pendingDesign);
+            designPending = false;
+        }
+    }
+
+    if (isSilent() || output.getNumChannels() == 0 || input.getNumChannels() == 0)
+        return false;
+
+    const int numSamples  = (int) juce::jmin(input.getNumSamples(), output.getNumSamples());
+    const float* inL      = input.getChannelPointer(0);
+    const float* inR      = input.getChannelPointer(juce::jmin((size_t) 1, input.getNumChannels() - 1));
+    float* outL           = output.getChannelPointer(0);
+    float* outR           = output.getChannelPointer(juce::jmin((size_t) 1, output.getNumChannels() - 1));
+    const bool stereoOut  = output.getNumChannels() > 1;
+
+    constexpr float hadamardScale = 0.35355339f;   // 1 / sqrt(8)
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        const int w = writePos;
+
+        inputRing[0][(size_t) (w & inputMask)] = inL[n];
+        inputRing[1][(size_t) (w & inputMask)] = inR[n];
+
+        const float xL = inputRing[0][(size_t) ((w - inputDelay) & inputMask)];
+        const float xR = inputRing[1][(size_t) ((w - inputDelay) & inputMask)];
+
+        float v[kNumLines];
+
+        for (int i = 0; i < kNumLines; ++i)
+        {
+            const float x = lines[i][(size_t) ((w - lineLength[i]) & lineMask)];
+
+            lineLowState[i] += crossover * (x - lineLowState[i]);
+            v[i] = lowGain[i] * lineLowState[i] + highGain[i] * (x - lineLowState[i]);
+        }
+
+        // Two orthogonal taps - decorrelated left and right
+        const float yL = v[0] + v[1] - v[2] - v[3] + v[4] + v[5] - v[6] - v[7];
+        const float yR = v[0] - v[1] + v[2] - v[3] + v[4] - v[5] + v[6] - v[7];
+
+        // Fast Walsh-Hadamard transform, normalised - lossless mixing
+        for (int len = 1; len < kNumLines; len <<= 1)
+        {
+            for (int i = 0; i < kNumLines; i += len << 1)
+            {
+                for (int j = i; j < i + len; ++j)
+                {
+                    const float a = v[j];
+                    const float b = v[j + len];
+                    v[j]       = a + b;
+                    v[j + len] = a - b;
+                }
+            }
+        }
+
+        // Left feeds the even lines, right the odd ones
+        for (int i = 0; i < kNumLines; ++i)
+            lines[i][(size_t) (w & lineMask)] = v[i] * hadamardScale + ((i & 1) == 0 ? xL : xR);
+
+        writePos = (w + 1) & (lineMask > inputMask ? lineMask : inputMask);
+
+        // Output level and tilt, per side
+        const float y[2] = { yL, yR };
+        float* out[2]    = { outL, outR };
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            outLowState[ch] += crossover * (y[ch] - outLowState[ch]);
+
+            const float s = outGain[ch][0].getNextValue() * outLowState[ch]
+                          + outGain[ch][1].getNextValue() * (y[ch] - outLowState[ch]);
+
+            if (ch == 0 || stereoOut)
+                out[ch][n] += s;
+        }
+    }
+
+    return true;
+}
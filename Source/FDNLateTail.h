@@ -0,0 +1,98 @@
+// FDNLateTail.h - Feedback delay network standing in for the late part of an IR
+//
+// Convolution can run just the first hundred milliseconds or so of an IR - the
+// early reflections, which are what make a space recognisable - and hand the
+// rest over to this network. Its decay in two bands and its output level per
+// channel and band are fitted to the IR's energy decay, so it picks up where
+// the convolution leaves off at a fraction of the CPU and memory of
+// convolving the whole tail.
+//
+// Eight lines, mixed through a normalised Hadamard matrix. Each line loses
+// the right amount per pass for its length in each band, so the whole network
+// decays at the fitted T60 regardless of which line the energy sits in.
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_dsp/juce_dsp.h>
+#endif
+
+class FDNLateTail
+{
+public:
+    static constexpr int    kNumLines    = 8;
+    static constexpr double kCrossoverHz = 1500.0;   // low / high band split
+
+    // Everything fitted from one IR. Plain data, handed over by copy.
+    struct Design
+    {
+        bool  active     = false;
+        int   inputDelay = 0;       // samples before the input reaches the lines
+        float decayLow   = 1.0f;    // T60 below kCrossoverHz, seconds
+        float decayHigh  = 1.0f;    // T60 above it
+
+        float gain[2][2] = { { 0.0f, 0.0f }, { 0.0f, 0.0f } };   // [output channel][low, high]
+    };
+
+    FDNLateTail();
+
+    // A tail that takes over from ir at handoverSample, fading in over the
+    // fadeSamples before it (while the convolution fades out). Inactive if
+    // the IR has too little left past the handover to measure. Not realtime
+    // safe.
+    static Design fit(const juce::AudioBuffer<float>& ir, double sampleRate,
+                      int handoverSample, int fadeSamples);
+
+    // maxInputDelay bounds Design::inputDelay from here on
+    void prepare(const juce::dsp::ProcessSpec& spec, int maxInputDelay);
+    void reset();
+
+    // Any thread but the audio thread. Picked up at the start of the next
+    // block; level changes ramp over kRampSeconds.
+    void setDesign(const Design& newDesign);
+
+    // Adds the tail's response to input onto output. A mono input feeds both
+    // sides. Does nothing (and costs nothing) while no design is active.
+    // Returns false when nothing was added.
+    bool process(const juce::dsp::AudioBlock<const float>& input,
+                 juce::dsp::AudioBlock<float>& output);
+
+    static constexpr double kRampSeconds = 0.05;
+
+private:
+    void applyDesign(const Design& d);
+    bool isSilent() const;
+
+    double sampleRate = 44100.0;
+
+    // Delay lines share one size and write position
+    std::vector<float> lines[kNumLines];
+    int lineLength[kNumLines] {};
+    int lineMask = 0;
+
+    // Input delay per side
+    std::vector<float> inputRing[2];
+    int inputMask = 0;
+    int inputDelay = 0;
+
+    int writePos = 0;
+
+    // Per pass, per line: low band gain, high band gain, and the crossover
+    // state splitting the two
+    float lowGain[kNumLines] {};
+    float highGain[kNumLines] {};
+    float lineLowState[kNumLines] {};
+    float outLowState[2] {};
+    float crossover = 0.0f;   // one-pole coefficient at kCrossoverHz
+
+    juce::SmoothedValue<float> outGain[2][2];
+
+    juce::SpinLock designLock;
+    Design pendingDesign;
+    bool   designPending = false;   // guarded by designLock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FDNLateTail)
+};
@@ -378,3 +378,12 @@ void HybridPlate::setParameters(const ReverbProcessorParameters& params)
         updateInternalParamsFromUserParams();
     }
 }
+
+void HybridPlate::setInterpolation(DelayInterpolation newInterpolation)
+{
+    preDelayL.setInterpolation(newInterpolation);
+    preDelayR.setInterpolation(newInterpolation);
+
+    for (auto& line : fdnLines)
+        line.setInterpolation(newInterpolation);
+}
@@ -38,6 +38,9 @@ public:
     ReverbProcessorParameters& getParameters() override;
     void setParameters(const ReverbProcessorParameters& params) override;
 
+    // Interpolation for the modulated tank reads and the pre-delay
+    void setInterpolation(DelayInterpolation newInterpolation);
+
 private:
     //======================================================================
     // Parameters
@@ -0,0 +1,291 @@
+#include "IRAnalysis.h"
+
+#if ! __has_include("JuceHeader.h")
+  #include <juce_dsp/juce_dsp.h>
+#endif
+
+namespace
+{
+    // Spectrum frames for the centroid - resolution well below any centroid
+    // worth telling apart
+    constexpr int kCentroidFFTOrder = 11;
+
+    // Octave-wide band-pass (RBJ, 0 dB at the centre), run over every
+    // channel of ir into band
+    void filterOctaveBand(const juce::AudioBuffer<float>& ir, double sampleRate, float centreHz,
+                          juce::AudioBuffer<float>& band)
+    {
+        const double w0    = juce::MathConstants<double>::twoPi * centreHz / sampleRate;
+        const double alpha = std::sin(w0) / (2.0 * juce::MathConstants<double>::sqrt2);
+        const double a0    = 1.0 + alpha;
+
+        const double b0 =  alpha / a0;
+        const double b2 = -alpha / a0;
+        const double a1 = -2.0 * std::cos(w0) / a0;
+        const double a2 = (1.0 - alpha) / a0;
+
+        band.setSize(ir.getNumChannels(), ir.getNumSamples(), false, false, true);
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            const float* x = ir.getReadPointer(ch);
+            float* y = band.getWritePointer(ch);
+            double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+
+            for (int n = 0; n < ir.getNumSamples(); ++n)
+            {
+                const double out = b0 * x[n] + b2 * x2 - a1 * y1 - a2 * y2;
+                x2 = x1; x1 = x[n];
+                y2 = y1; y1 = out;
+                y[n] = (float) out;
+            }
+        }
+    }
+
+    // Power-weighted mean frequency over Hann-windowed frames of the first
+    // numSamples, all channels
+    float measureSpectralCentroid(const juce::AudioBuffer<float>& ir, double sampleRate, int numSamples)
+    {
+        juce::dsp::FFT fft(kCentroidFFTOrder);
+        const int frameSize = fft.getSize();
+        const int hop       = frameSize / 2;
+
+        std::vector<float> window((size_t) frameSize);
+        for (int n = 0; n < frameSize; ++n)
+            window[(size_t) n] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * (float) n / (float) frameSize);
+
+        std::vector<float> frame((size_t) frameSize * 2);
+        std::vector<double> power((size_t) frameSize / 2 + 1, 0.0);
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            const float* x = ir.getReadPointer(ch);
+
+            for (int start = 0; start < numSamples; start += hop)
+            {
+                std::fill(frame.begin(), frame.end(), 0.0f);
+
+                const int count = juce::jmin(frameSize, numSamples - start);
+                for (int n = 0; n < count; ++n)
+                    frame[(size_t) n] = x[start + n] * window[(size_t) n];
+
+                fft.performFrequencyOnlyForwardTransform(frame.data());
+
+                for (size_t k = 0; k < power.size(); ++k)
+                    power[k] += (double) frame[k] * frame[k];
+            }
+        }
+
+        double weighted = 0.0, total = 0.0;
+        for (size_t k = 0; k < power.size(); ++k)
+        {
+            weighted += power[k] * (double) k;
+            total    += power[k];
+        }
+
+        return total > 0.0 ? (float) (weighted / total * sampleRate / frameSize) : 0.0f;
+    }
+}
+
+namespace IRAnalysis
+{
+    std::vector<float> computeEnergyDecayCurve(const juce::AudioBuffer<float>& ir)
+    {
+        const int numSamples  = ir.getNumSamples();
+        const int numChannels = ir.getNumChannels();
+
+        if (numSamples == 0 || numChannels == 0)
+            return {};
+
+        // Backward integration in double - the tail of a long IR is many orders
+        // of magnitude below the total and would vanish in float
+        std::vector<double> energy((size_t) numSamples, 0.0);
+
+        double running = 0.0;
+        for (int n = numSamples - 1; n >= 0; --n)
+        {
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                const double x = ir.getSample(ch, n);
+                running += x * x;
+            }
+
+            energy[(size_t) n] = running;
+        }
+
+        const double total = energy[0];
+        if (total <= 0.0)
+            return {};
+
+        std::vector<float> edc((size_t) numSamples);
+        for (int n = 0; n < numSamples; ++n)
+            edc[(size_t) n] = energy[(size_t) n] > 0.0
+                                ? (float) (10.0 * std::log10(energy[(size_t) n] / total))
+                                : -300.0f;
+
+        return edc;
+    }
+
+    float estimateDecayTime(const std::vector<float>& edc, double sampleRate, int fromSample)
+    {
+        const int numSamples = (int) edc.size();
+
+        if (sampleRate <= 0.0 || !juce::isPositiveAndBelow(fromSample, numSamples))
+            return 0.0f;
+
+        const float startDb = edc[(size_t) fromSample] - 5.0f;
+        const float endDb   = edc[(size_t) fromSample] - 35.0f;
+
+        // The last few percent bend down towards the end of the data, not
+        // the room - never fit those
+        const int usable = fromSample + (int) (0.95 * (numSamples - fromSample));
+
+        int first = fromSample;
+        while (first < usable && edc[(size_t) first] > startDb)
+            ++first;
+
+        int last = first;
+        while (last < usable && edc[(size_t) last] > endDb)
+            ++last;
+
+        if (last - first < 2 || edc[(size_t) first] - edc[(size_t) last] < 10.0f)
+            return 0.0f;
+
+        // Least squares slope in dB per sample
+        double sumX = 0.0, sumY = 0.0, sumXY = 0.0, sumXX = 0.0;
+        const int count = last - first;
+
+        for (int n = first; n < last; ++n)
+        {
+            const double x = n - first;
+            const double y = edc[(size_t) n];
+            sumX  += x;
+            sumY  += y;
+            sumXY += x * y;
+            sumXX += x * x;
+        }
+
+        const double slope = (count * sumXY - sumX * sumY) / (count * sumXX - sumX * sumX);
+
+        return slope < 0.0 ? (float) (-60.0 / (slope * sampleRate)) : 0.0f;
+    }
+
+    Summary analyse(const juce::AudioBuffer<float>& ir, double sampleRate,
+                    const std::function<bool()>& shouldStop)
+    {
+        Summary summary;
+
+        auto stopping = [&shouldStop] { return shouldStop != nullptr && shouldStop(); };
+
+        const auto edc = computeEnergyDecayCurve(ir);
+
+        if (edc.empty() || sampleRate <= 0.0 || stopping())
+            return summary;
+
+        summary.rt60 = estimateDecayTime(edc, sampleRate);
+
+        // Same cut findTrimPoint makes at the default floor
+        const auto end = std::find_if(edc.begin(), edc.end(),
+                                      [](float db) { return db <= kDefaultTrimFloorDb; });
+        const int effectiveLength = juce::jmax(1, (int) std::distance(edc.begin(), end));
+        summary.effectiveLengthSeconds = (float) (effectiveLength / sampleRate);
+
+        const int step = juce::jmax((int) (0.01 * sampleRate),
+                                    (effectiveLength + kMaxSummaryEDCPoints - 1) / kMaxSummaryEDCPoints);
+        summary.edcStepSeconds = (float) (step / sampleRate);
+
+        for (int n = 0; n < effectiveLength; n += step)
+            summary.edcDb.push_back(edc[(size_t) n]);
+
+        // What the engine would play it at
+        summary.peakDb = juce::Decibels::gainToDecibels(ir.getMagnitude(0, ir.getNumSamples())
+                                                        * getNormalisationGain(ir));
+
+        // Bands past the top of the spectrum are left at 0
+        juce::AudioBuffer<float> band;
+
+        for (int b = 0; b < Summary::kNumOctaveBands; ++b)
+        {
+            const float centreHz = Summary::getOctaveBandHz(b);
+
+            if (centreHz * 1.5f >= sampleRate * 0.5 || stopping())
+                break;
+
+            filterOctaveBand(ir, sampleRate, centreHz, band);
+            summary.rt60Octave[b] = estimateDecayTime(computeEnergyDecayCurve(band), sampleRate);
+        }
+
+        if (!stopping())
+            summary.spectralCentroidHz = measureSpectralCentroid(ir, sampleRate, effectiveLength);
+
+        return summary;
+    }
+
+    int findTrimPoint(const juce::AudioBuffer<float>& ir, float floorDb)
+    {
+        const auto edc = computeEnergyDecayCurve(ir);
+
+        if (edc.empty())
+            return ir.getNumSamples();
+
+        // The curve is monotonically non-increasing, so the first sample at or
+        // below the floor is where everything after it is noise
+        const auto it = std::find_if(edc.begin(), edc.end(),
+                                     [floorDb](float db) { return db <= floorDb; });
+
+        return juce::jmax(1, (int) std::distance(edc.begin(), it));
+    }
+
+    float getNormalisationGain(const juce::AudioBuffer<float>& ir)
+    {
+        float maxSumSquared = 0.0f;
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            const float* data = ir.getReadPointer(ch);
+            float sum = 0.0f;
+            for (int n = 0; n < ir.getNumSamples(); ++n)
+                sum += data[n] * data[n];
+            maxSumSquared = juce::jmax(maxSumSquared, sum);
+        }
+
+        return maxSumSquared > 0.0f ? 0.125f / std::sqrt(maxSumSquared) : 1.0f;
+    }
+
+    bool isDualMono(const juce::AudioBuffer<float>& ir)
+    {
+        if (ir.getNumChannels() != 2 || ir.getNumSamples() == 0)
+            return false;
+
+        const float tolerance = ir.getMagnitude(0, ir.getNumSamples()) * 1.0e-5f;
+        const float* l = ir.getReadPointer(0);
+        const float* r = ir.getReadPointer(1);
+
+        for (int n = 0; n < ir.getNumSamples(); ++n)
+            if (std::abs(l[n] - r[n]) > tolerance)
+                return false;
+
+        return true;
+    }
+
+    void truncateWithFade(juce::AudioBuffer<float>& ir, int numSamples, int fadeSamples)
+    {
+        numSamples  = juce::jlimit(1, ir.getNumSamples(), numSamples);
+        fadeSamples = juce::jlimit(0, numSamples, fadeSamples);
+
+        const int fadeStart = numSamples - fadeSamples;
+
+        for (int ch = 0; ch < ir.getNumChannels(); ++ch)
+        {
+            float* data = ir.getWritePointer(ch);
+
+            for (int i = 0; i < fadeSamples; ++i)
+            {
+                const float phase = (float) (i + 1) / (float) fadeSamples;
+                data[fadeStart + i] *= 0.5f * (1.0f + std::cos(juce::MathConstants<float>::pi * phase));
+            }
+        }
+
+        ir.setSize(ir.getNumChannels(), numSamples, true);
+    }
+}
@@ -0,0 +1,75 @@
+// IRAnalysis.h - Offline measurements on impulse responses
+//
+// Runs on the loader thread when an IR is (re)partitioned, or on the IR bank's
+// discovery thread, never on the audio thread.
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_audio_basics/juce_audio_basics.h>
+#endif
+
+namespace IRAnalysis
+{
+    // Level below which the Schroeder decay is considered noise floor
+    constexpr float kDefaultTrimFloorDb = -90.0f;
+
+    // Everything measured on one IR. IRBank works it out once per IR in the
+    // background and keeps it with its index.
+    struct Summary
+    {
+        static constexpr int kNumOctaveBands = 7;   // 125 Hz to 8 kHz
+
+        float rt60 = 0.0f;                             // broadband, seconds; 0 = no usable decay
+        float rt60Octave[kNumOctaveBands] {};          // per octave band, same rules
+        float effectiveLengthSeconds = 0.0f;           // to kDefaultTrimFloorDb on the decay curve
+        float peakDb = -100.0f;                        // at the engine's reference level
+        float spectralCentroidHz = 0.0f;
+
+        // Energy decay curve over the effective length, one point per
+        // edcStepSeconds
+        std::vector<float> edcDb;
+        float edcStepSeconds = 0.0f;
+
+        static float getOctaveBandHz(int band) { return 125.0f * (float) (1 << band); }
+    };
+
+    // Most points Summary::edcDb holds - the step grows for long IRs
+    constexpr int kMaxSummaryEDCPoints = 200;
+
+    // Measures ir at sampleRate. Takes a while for a long IR; shouldStop, if
+    // given, is polled between measurements and a true stops it early with
+    // the summary incomplete.
+    Summary analyse(const juce::AudioBuffer<float>& ir, double sampleRate,
+                    const std::function<bool()>& shouldStop = nullptr);
+
+    // Schroeder backward-integrated energy decay curve, summed over channels,
+    // in dB relative to the total energy (so edc[0] == 0 dB). Empty for a
+    // silent IR.
+    std::vector<float> computeEnergyDecayCurve(const juce::AudioBuffer<float>& ir);
+
+    // Reverberation time (seconds to fall 60 dB) from a straight-line fit to
+    // edc between 5 and 35 dB below its level at fromSample (T30), or down to
+    // where the curve runs out if it never falls that far. 0 if there is less
+    // than 10 dB of decay to fit.
+    float estimateDecayTime(const std::vector<float>& edc, double sampleRate, int fromSample = 0);
+
+    // Number of samples to keep so that everything after the cut lies below
+    // floorDb on the decay curve. Returns the full length for a silent IR.
+    int findTrimPoint(const juce::AudioBuffer<float>& ir, float floorDb);
+
+    // Gain that brings ir to the engine's reference level - the energy
+    // normalisation juce::dsp::Convolution applied (Normalise::yes). 1 for a
+    // silent IR.
+    float getNormalisationGain(const juce::AudioBuffer<float>& ir);
+
+    // True for a two-channel IR whose channels match to within -100 dB of its
+    // peak - such files are kept and convolved as mono
+    bool isDualMono(const juce::AudioBuffer<float>& ir);
+
+    // Shortens ir to numSamples, fading the last fadeSamples out with a
+    // raised-cosine ramp so the cut never clicks
+    void truncateWithFade(juce::AudioBuffer<float>& ir, int numSamples, int fadeSamples);
+}
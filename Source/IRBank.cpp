@@ -0,0 +1,600 @@
+#include "IRBank.h"
+
+#include <limits>
+#include <map>
+
+namespace
+{
+    // Same order IRPackBuilder packs in, so saved IR indices survive switching
+    // between the folder and the pack
+    struct FileSorter
+    {
+        static int compareElements(const juce::File& first, const juce::File& second)
+        {
+            return first.getFileName().compareNatural(second.getFileName());
+        }
+    };
+
+    constexpr int kIndexVersion = 1;
+
+    // Bumped whenever IRAnalysis::analyse measures differently - older
+    // stored results are then redone
+    constexpr int kAnalysisVersion = 1;
+
+    // Index writes during the analysis pass - an interrupted pass loses at
+    // most this many results
+    constexpr int kAnalysesPerIndexWrite = 8;
+
+    juce::String joinValues(const float* values, size_t count, int decimals)
+    {
+        juce::StringArray parts;
+        for (size_t i = 0; i < count; ++i)
+            parts.add(juce::String(values[i], decimals));
+        return parts.joinIntoString(" ");
+    }
+
+    std::vector<float> splitValues(const juce::String& text)
+    {
+        std::vector<float> values;
+        for (const auto& part : juce::StringArray::fromTokens(text, " ", {}))
+            if (part.isNotEmpty())
+                values.push_back(part.getFloatValue());
+        return values;
+    }
+
+    std::unique_ptr<juce::XmlElement> analysisToXml(const IRAnalysis::Summary& summary)
+    {
+        auto xml = std::make_unique<juce::XmlElement>("ANALYSIS");
+        xml->setAttribute("version",  kAnalysisVersion);
+        xml->setAttribute("rt60",     summary.rt60);
+        xml->setAttribute("octaves",  joinValues(summary.rt60Octave, IRAnalysis::Summary::kNumOctaveBands, 3));
+        xml->setAttribute("length",   summary.effectiveLengthSeconds);
+        xml->setAttribute("peak",     summary.peakDb);
+        xml->setAttribute("centroid", summary.spectralCentroidHz);
+        xml->setAttribute("edcStep",  summary.edcStepSeconds);
+        xml->setAttribute("edc",      joinValues(summary.edcDb.data(), summary.edcDb.size(), 1));
+        return xml;
+    }
+
+    // nullptr if entry has no analysis, or one from an older version
+    std::shared_ptr<const IRAnalysis::Summary> analysisFromXml(const juce::XmlElement& entry)
+    {
+        const auto* xml = entry.getChildByName("ANALYSIS");
+
+        if (xml == nullptr || xml->getIntAttribute("version") != kAnalysisVersion)
+            return nullptr;
+
+        auto summary = std::make_shared<IRAnalysis::Summary>();
+        summary->rt60                   = (float) xml->getDoubleAttribute("rt60");
+        summary->effectiveLengthSeconds = (float) xml->getDoubleAttribute("length");
+        summary->peakDb                 = (float) xml->getDoubleAttribute("peak", -100.0);
+        summary->spectralCentroidHz     = (float) xml->getDoubleAttribute("centroid");
+        summary->edcStepSeconds         = (float) xml->getDoubleAttribute("edcStep");
+        summary->edcDb                  = splitValues(xml->getStringAttribute("edc"));
+
+        const auto octaves = splitValues(xml->getStringAttribute("octaves"));
+        for (size_t b = 0; b < octaves.size() && b < (size_t) IRAnalysis::Summary::kNumOctaveBands; ++b)
+            summary->rt60Octave[b] = octaves[b];
+
+        return summary;
+    }
+
+    // A loose IR at its own rate, straight from the file - not through
+    // IRCache, which would keep every analysed IR in memory
+    std::unique_ptr<IRCache::DecodedIR> decodeForAnalysis(juce::AudioFormatManager& formatManager,
+                                                          const juce::File& file)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+        if (reader == nullptr || reader->lengthInSamples <= 0
+            || reader->lengthInSamples > std::numeric_limits<int>::max())
+            return nullptr;
+
+        auto ir = std::make_unique<IRCache::DecodedIR>();
+        ir->sampleRate = reader->sampleRate;
+        ir->buffer.setSize((int) reader->numChannels, (int) reader->lengthInSamples);
+
+        if (!reader->read(&ir->buffer, 0, (int) reader->lengthInSamples, 0, true, true))
+            return nullptr;
+
+        return ir;
+    }
+}
+
+IRBank::IRBank()
+    : juce::Thread("IR Bank Discovery")
+{
+    auto initial = std::make_shared<Contents>();
+    initial->irs.push_back(makeBypassInfo());
+    contents = std::move(initial);
+}
+
+void IRBank::startDiscovery()
+{
+    startThread(juce::Thread::Priority::background);
+}
+
+IRBank::~IRBank()
+{
+    stopThread(4000);
+}
+
+IRBank::IRInfo IRBank::makeBypassInfo()
+{
+    IRInfo bypass;
+    bypass.name = "Bypass";
+    return bypass;
+}
+
+std::shared_ptr<const IRBank::Contents> IRBank::getContents() const
+{
+    const juce::ScopedLock sl(contentsLock);
+    return contents;
+}
+
+void IRBank::publishAnalysis(int index, std::shared_ptr<const IRAnalysis::Summary> summary)
+{
+    {
+        const juce::ScopedLock sl(contentsLock);
+
+        auto updated = std::make_shared<Contents>(*contents);
+        updated->irs[(size_t)index].analysis = std::move(summary);
+        contents = std::move(updated);
+    }
+
+    listeners.call([index](Listener& l) { l.irAnalysed(index); });
+}
+
+void IRBank::publish(std::shared_ptr<const Contents> newContents)
+{
+    {
+        const juce::ScopedLock sl(contentsLock);
+        contents = std::move(newContents);
+    }
+
+    ready.store(true, std::memory_order_release);
+    listeners.call([](Listener& l) { l.irListChanged(); });
+}
+
+juce::File IRBank::getIRFile(int index) const
+{
+    return getIRInfo(index).file;
+}
+
+IRBank::IRInfo IRBank::getIRInfo(int index) const
+{
+    auto c = getContents();
+
+    if (juce::isPositiveAndBelow(index, (int)c->irs.size()))
+        return c->irs[(size_t)index];
+    return {};
+}
+
+IRCache::IRPtr IRBank::getIR(int index, double sampleRate) const
+{
+    auto c = getContents();
+
+    if (!juce::isPositiveAndBelow(index, (int)c->irs.size()))
+        return nullptr;
+
+    const auto& info = c->irs[(size_t)index];
+
+    if (c->pack != nullptr && info.packIndex >= 0)
+    {
+        // Pointer lookup into the mapped pack when the rate was packed;
+        // otherwise resampled from the closest packed rate, once per user (see
+        // IRCache::getResampled)
+        auto packed = c->pack->getIR(info.packIndex, sampleRate);
+
+        if (sampleRate <= 0.0 || packed->sampleRate == sampleRate)
+            return packed;
+
+        return irCache->getResampled(c->pack->getIdentity() + "|" + juce::String(info.packIndex), sampleRate,
+                                     [&packed] { return packed; });
+    }
+
+    if (!info.file.existsAsFile())
+        return nullptr;
+    return irCache->getIR(info.file, sampleRate);
+}
+
+juce::String IRBank::getIRName(int index) const
+{
+    auto c = getContents();
+
+    if (juce::isPositiveAndBelow(index, (int)c->irs.size()))
+        return c->irs[(size_t)index].name;
+    return "No IR";
+}
+
+int IRBank::getNumIRs() const
+{
+    return (int)getContents()->irs.size();
+}
+
+juce::StringArray IRBank::getIRNames() const
+{
+    juce::StringArray names;
+    for (const auto& ir : getContents()->irs)
+        names.add(ir.name);
+    return names;
+}
+
+//==============================================================================
+
+void IRBank::run()
+{
+    discover();
+
+    if (!threadShouldExit())
+        analyseAll();
+}
+
+void IRBank::discover()
+{
+    // Get the plugin binary location
+    auto pluginPath = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
+
+    juce::File irFolder;
+
+    #if JUCE_WINDOWS
+        // Windows VST3 structure:
+        // ADSREcho.vst3/Contents/x86_64-win/ADSREcho.vst3
+        // We want: ADSREcho.vst3/Contents/x86_64-win/IRs
+        irFolder = pluginPath.getParentDirectory().getChildFile("IRs");
+    #elif JUCE_MAC
+        // macOS VST3 structure:
+        // ADSREcho.vst3/Contents/MacOS/ADSREcho
+        // We want: ADSREcho.vst3/Contents/Resources/IRs
+        irFolder = pluginPath.getParentDirectory()
+                             .getParentDirectory()
+                             .getChildFile("Resources")
+                             .getChildFile("IRs");
+    #else
+        // Linux fallback
+        irFolder = pluginPath.getParentDirectory().getChildFile("IRs");
+    #endif
+
+    // Packed archive installed next to where the folder would be
+    if (auto packed = loadIRsFromPack(irFolder.getSiblingFile("IRs.irpack")))
+    {
+        publish(std::move(packed));
+        return;
+    }
+
+    // If not found in plugin bundle, try development location
+    if (!irFolder.isDirectory())
+    {
+        // Try to find Source/IRs by going up from plugin
+        auto searchDir = pluginPath.getParentDirectory();
+
+        for (int i = 0; i < 10; ++i)
+        {
+            // Build tree - the IRPack target writes the archive to the build root
+            if (auto packed = loadIRsFromPack(searchDir.getChildFile("IRs.irpack")))
+            {
+                publish(std::move(packed));
+                return;
+            }
+
+            auto testFolder = searchDir.getChildFile("Source").getChildFile("IRs");
+
+            if (testFolder.isDirectory())
+            {
+                irFolder = testFolder;
+                break;
+            }
+
+            searchDir = searchDir.getParentDirectory();
+        }
+    }
+
+    if (!irFolder.isDirectory())
+    {
+        DBG("IRBank - IR folder not found, expected: " + irFolder.getFullPathName()
+            + " (run the post-build script to copy IRs)");
+
+        // Bypass only - already what the bank holds
+        ready.store(true, std::memory_order_release);
+        return;
+    }
+
+    if (auto scanned = loadIRsFromFolder(irFolder))
+        publish(std::move(scanned));
+}
+
+void IRBank::analyseAll()
+{
+    auto c = getContents();
+
+    std::unique_ptr<juce::XmlElement> index;
+    juce::AudioFormatManager formatManager;
+    int numAnalysed = 0;
+
+    auto writeIndex = [&index]
+    {
+        const auto indexFile = getIndexFile();
+
+        if (!indexFile.getParentDirectory().createDirectory() || !index->writeTo(indexFile))
+            DBG("IRBank - Could not write IR index: " + indexFile.getFullPathName());
+    };
+
+    for (int i = 1; i < (int)c->irs.size(); ++i)
+    {
+        if (threadShouldExit())
+            break;
+
+        const auto& info = c->irs[(size_t)i];
+
+        if (info.analysis != nullptr)
+            continue;
+
+        IRCache::IRPtr ir;
+
+        if (c->pack != nullptr && info.packIndex >= 0)
+        {
+            ir = c->pack->getIR(info.packIndex, 0.0);
+        }
+        else
+        {
+            if (formatManager.getNumKnownFormats() == 0)
+                formatManager.registerBasicFormats();
+
+            ir = decodeForAnalysis(formatManager, info.file);
+        }
+
+        if (ir == nullptr)
+            continue;
+
+        // A long IR takes a while - give up part way if the bank is closing
+        auto summary = std::make_shared<const IRAnalysis::Summary>(
+            IRAnalysis::analyse(ir->buffer, ir->sampleRate, [this] { return threadShouldExit(); }));
+        ir = nullptr;
+
+        if (threadShouldExit())
+            break;
+
+        publishAnalysis(i, summary);
+
+        // Read back once, after discovery has written its own entries
+        if (index == nullptr)
+            index = loadIndex();
+
+        if (auto* entry = findIndexEntry(*index, *c, info, true))
+        {
+            if (auto* old = entry->getChildByName("ANALYSIS"))
+                entry->removeChildElement(old, true);
+
+            entry->addChildElement(analysisToXml(*summary).release());
+        }
+
+        if (++numAnalysed % kAnalysesPerIndexWrite == 0)
+            writeIndex();
+    }
+
+    if (numAnalysed % kAnalysesPerIndexWrite != 0)
+        writeIndex();
+
+    if (!threadShouldExit())
+        analysisComplete.store(true, std::memory_order_release);
+
+    DBG("IRBank - " + juce::String(numAnalysed) + " IRs analysed");
+}
+
+juce::XmlElement* IRBank::findIndexEntry(juce::XmlElement& index, const Contents& c,
+                                         const IRInfo& info, bool create)
+{
+    if (c.pack != nullptr && info.packIndex >= 0)
+    {
+        const auto& identity = c.pack->getIdentity();
+        auto* packXml = index.getChildByAttribute("identity", identity);
+
+        if (packXml == nullptr)
+        {
+            if (!create)
+                return nullptr;
+
+            // A rebuilt pack at the same path - its old results no longer apply
+            const auto path = identity.upToLastOccurrenceOf("|", false, false)
+                                      .upToLastOccurrenceOf("|", false, false);
+
+            for (int i = index.getNumChildElements(); --i >= 0;)
+                if (auto* old = index.getChildElement(i); old->hasTagName("PACK")
+                                                          && old->getStringAttribute("path") == path)
+                    index.removeChildElement(old, true);
+
+            packXml = index.createNewChildElement("PACK");
+            packXml->setAttribute("identity", identity);
+            packXml->setAttribute("path", path);
+        }
+
+        auto* entry = packXml->getChildByAttribute("entry", juce::String(info.packIndex));
+
+        if (entry == nullptr && create)
+        {
+            entry = packXml->createNewChildElement("IR");
+            entry->setAttribute("entry", info.packIndex);
+        }
+
+        return entry;
+    }
+
+    // Loose files - discovery wrote the entry unless the index couldn't be saved
+    auto* folderXml = index.getChildByAttribute("path", info.file.getParentDirectory().getFullPathName());
+
+    return folderXml != nullptr ? folderXml->getChildByAttribute("file", info.file.getFullPathName())
+                                : nullptr;
+}
+
+std::shared_ptr<const IRBank::Contents> IRBank::loadIRsFromPack(const juce::File& packFile) const
+{
+    auto pack = IRPack::open(packFile);
+
+    if (pack == nullptr)
+        return nullptr;
+
+    auto result = std::make_shared<Contents>();
+    result->pack = pack;
+    result->irs.push_back(makeBypassInfo());
+
+    for (int i = 0; i < pack->getNumIRs(); ++i)
+    {
+        IRInfo info;
+        info.name      = pack->getName(i);
+        info.packIndex = i;
+
+        // A view into the mapping - reading its size touches no sample data
+        if (auto view = pack->getIR(i, 0.0))
+        {
+            info.numChannels     = view->buffer.getNumChannels();
+            info.lengthInSamples = view->buffer.getNumSamples();
+            info.sampleRate      = view->sampleRate;
+        }
+
+        result->irs.push_back(info);
+    }
+
+    // Analysed in an earlier session
+    auto index = loadIndex();
+
+    for (auto& info : result->irs)
+        if (info.packIndex >= 0)
+            if (auto* entry = findIndexEntry(*index, *result, info, false))
+                info.analysis = analysisFromXml(*entry);
+
+    DBG("IRBank - " + juce::String(pack->getNumIRs()) + " IRs from pack " + packFile.getFullPathName());
+    return result;
+}
+
+std::shared_ptr<const IRBank::Contents> IRBank::loadIRsFromFolder(const juce::File& irFolder)
+{
+    // What the last scan of this folder found, by path
+    const auto indexFile = getIndexFile();
+    auto index = loadIndex();
+
+    auto* folderXml = index->getChildByAttribute("path", irFolder.getFullPathName());
+
+    std::map<juce::String, const juce::XmlElement*> known;
+    if (folderXml != nullptr)
+        for (auto* entry : folderXml->getChildWithTagNameIterator("IR"))
+            known[entry->getStringAttribute("file")] = entry;
+
+    auto wavFiles = irFolder.findChildFiles(juce::File::findFiles, false, "*.wav;*.WAV");
+
+    FileSorter sorter;
+    wavFiles.sort(sorter);
+
+    auto result = std::make_shared<Contents>();
+    result->irs.push_back(makeBypassInfo());
+
+    auto newFolderXml = std::make_unique<juce::XmlElement>("FOLDER");
+    newFolderXml->setAttribute("path", irFolder.getFullPathName());
+
+    juce::AudioFormatManager formatManager;
+    bool registeredFormats = false;
+    int  numRead = 0;
+
+    for (const auto& file : wavFiles)
+    {
+        if (threadShouldExit())
+            return nullptr;
+
+        const auto path     = file.getFullPathName();
+        const auto size     = file.getSize();
+        const auto modified = file.getLastModificationTime().toMilliseconds();
+
+        IRInfo info;
+        info.name = file.getFileNameWithoutExtension();
+        info.file = file;
+
+        // Unchanged since the last scan - the index entry is trusted and the
+        // file is not opened
+        auto it = known.find(path);
+        const juce::XmlElement* trusted = nullptr;
+
+        if (it != known.end()
+            && it->second->getStringAttribute("size").getLargeIntValue() == size
+            && it->second->getStringAttribute("modified").getLargeIntValue() == modified)
+        {
+            trusted = it->second;
+
+            info.numChannels     = trusted->getIntAttribute("channels");
+            info.lengthInSamples = trusted->getStringAttribute("length").getLargeIntValue();
+            info.sampleRate      = trusted->getDoubleAttribute("sampleRate");
+            info.analysis        = analysisFromXml(*trusted);
+        }
+        else
+        {
+            if (!registeredFormats)
+            {
+                formatManager.registerBasicFormats();
+                registeredFormats = true;
+            }
+
+            // Header only - the samples are decoded by IRCache when used
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+            if (reader != nullptr)
+            {
+                info.numChannels     = (int)reader->numChannels;
+                info.lengthInSamples = reader->lengthInSamples;
+                info.sampleRate      = reader->sampleRate;
+            }
+
+            ++numRead;
+        }
+
+        result->irs.push_back(info);
+
+        auto* entry = newFolderXml->createNewChildElement("IR");
+        entry->setAttribute("file",       path);
+        entry->setAttribute("name",       info.name);
+        entry->setAttribute("size",       juce::String(size));
+        entry->setAttribute("modified",   juce::String(modified));
+        entry->setAttribute("channels",   info.numChannels);
+        entry->setAttribute("length",     juce::String(info.lengthInSamples));
+        entry->setAttribute("sampleRate", info.sampleRate);
+
+        // Carried over, or picked up by the analysis pass
+        if (trusted != nullptr)
+            if (auto* analysis = trusted->getChildByName("ANALYSIS"))
+                entry->addChildElement(new juce::XmlElement(*analysis));
+    }
+
+    const bool changed = numRead > 0
+                      || folderXml == nullptr
+                      || folderXml->getNumChildElements() != newFolderXml->getNumChildElements();
+
+    if (changed)
+    {
+        if (folderXml != nullptr)
+            index->replaceChildElement(folderXml, newFolderXml.release());
+        else
+            index->addChildElement(newFolderXml.release());
+
+        if (!indexFile.getParentDirectory().createDirectory() || !index->writeTo(indexFile))
+            DBG("IRBank - Could not write IR index: " + indexFile.getFullPathName());
+    }
+
+    DBG("IRBank - " + juce::String(wavFiles.size()) + " IRs in " + irFolder.getFullPathName()
+        + " (" + juce::String(numRead) + " read, " + juce::String(wavFiles.size() - numRead) + " from index)");
+
+    return result;
+}
+
+juce::File IRBank::getIndexFile()
+{
+    return IRCache::getUserDataDirectory().getChildFile("IRIndex.xml");
+}
+
+std::unique_ptr<juce::XmlElement> IRBank::loadIndex()
+{
+    auto index = juce::XmlDocument::parse(getIndexFile());
+
+    if (index == nullptr || !index->hasTagName("IR_INDEX")
+        || index->getIntAttribute("version") != kIndexVersion)
+        index = std::make_unique<juce::XmlElement>("IR_INDEX");
+
+    index->setAttribute("version", kIndexVersion);
+    return index;
+}
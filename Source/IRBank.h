@@ -1,6 +1,19 @@
 // ==============================================================================
 // IRBank.h - Manages impulse response files
-// Looks for IRs next to the plugin binary (where post-build script copies them)
+// Looks for IRs next to the plugin binary (where post-build script copies them).
+// A packed archive (IRs.irpack, see IRPack.h) is preferred over the folder of
+// WAVs when present - no directory scan, no decoding.
+//
+// Discovery runs on a background thread so creating a plugin instance never
+// waits on the filesystem. Until it finishes the bank holds only Bypass;
+// listeners are told when the real list is in. A folder scan is remembered in
+// an index file in the user's application data folder and trusted on the next
+// start as long as the folder and every file in it are unchanged.
+//
+// Once the list is out, the same thread measures every IR (decay times, decay
+// curve, effective length, peak level, spectral centroid - see
+// IRAnalysis::analyse) and stores the results in the index too, so each IR
+// is analysed once per user rather than on every load.
 // ==============================================================================
 #pragma once
 
@@ -9,177 +22,120 @@
 #else
   #include <juce_core/juce_core.h>
   #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_audio_formats/juce_audio_formats.h>
 #endif
 
-class IRBank
+#include "IRAnalysis.h"
+#include "IRCache.h"
+#include "IRPack.h"
+
+class IRBank : private juce::Thread
 {
 public:
     struct IRInfo
     {
         juce::String name;
         juce::File file;
+        int packIndex = -1;     // entry in the IR pack, -1 = loose file
+
+        // From the file header (or the pack) - 0 for Bypass
+        int         numChannels     = 0;
+        juce::int64 lengthInSamples = 0;
+        double      sampleRate      = 0.0;
+
+        // Filled in by the background analysis - nullptr until then, and
+        // always for Bypass
+        std::shared_ptr<const IRAnalysis::Summary> analysis;
+
+        double getLengthSeconds() const { return sampleRate > 0.0 ? (double)lengthInSamples / sampleRate : 0.0; }
     };
-    
-    IRBank()
+
+    // Called on the discovery thread once the list is available, and as each
+    // IR's analysis comes in. Keep them short - record the change and pick it
+    // up elsewhere.
+    struct Listener
     {
-        DBG("=== IRBank Constructor ===");
-        loadIRsFromPluginBundle();
-        DBG("IRBank initialized with " + juce::String(irList.size()) + " total entries");
-    }
-    
+        virtual ~Listener() = default;
+        virtual void irListChanged() = 0;
+        virtual void irAnalysed(int index) { juce::ignoreUnused(index); }
+    };
+
+    IRBank();
+    ~IRBank() override;
+
+    // Starts the discovery thread. Add listeners first - the list can be
+    // published before the call returns.
+    void startDiscovery();
+
+    void addListener(Listener* listener)    { listeners.add(listener); }
+    void removeListener(Listener* listener) { listeners.remove(listener); }
+
+    // False while the discovery thread is still working
+    bool isReady() const { return ready.load(std::memory_order_acquire); }
+
+    // True once every IR in the list has an analysis (or can't be read)
+    bool isAnalysisComplete() const { return analysisComplete.load(std::memory_order_acquire); }
+
     // Get IR file at index
-    juce::File getIRFile(int index) const
-    {
-        if (juce::isPositiveAndBelow(index, irList.size()))
-            return irList[index].file;
-        return juce::File();
-    }
-    
+    juce::File getIRFile(int index) const;
+
+    // Name, file and header info at index (a default IRInfo if out of range)
+    IRInfo getIRInfo(int index) const;
+
+    // Decoded IR at index, resampled to sampleRate (0 = file rate), through
+    // the process-wide IRCache. nullptr for Bypass or a missing file.
+    IRCache::IRPtr getIR(int index, double sampleRate) const;
+
     // Get IR name at index
-    juce::String getIRName(int index) const
-    {
-        if (juce::isPositiveAndBelow(index, irList.size()))
-            return irList[index].name;
-        return "No IR";
-    }
-    
+    juce::String getIRName(int index) const;
+
     // Get number of IRs
-    int getNumIRs() const 
-    { 
-        return (int)irList.size(); 
-    }
-    
+    int getNumIRs() const;
+
     // Get all IR names for UI
-    juce::StringArray getIRNames() const
-    {
-        juce::StringArray names;
-        for (const auto& ir : irList)
-            names.add(ir.name);
-        return names;
-    }
+    juce::StringArray getIRNames() const;
 
 private:
-    std::vector<IRInfo> irList;
-    
-    void loadIRsFromPluginBundle()
+    // Everything discovery produces, published in one piece so readers on
+    // other threads always see a list and the pack it indexes together
+    struct Contents
     {
-        DBG("=== IRBank::loadIRsFromPluginBundle ===");
-        
-        // Get the plugin binary location
-        auto pluginPath = juce::File::getSpecialLocation(juce::File::currentExecutableFile);
-        DBG("Plugin Path: " + pluginPath.getFullPathName());
-        
-        juce::File irFolder;
-        
-        #if JUCE_WINDOWS
-            // Windows VST3 structure:
-            // ADSREcho.vst3/Contents/x86_64-win/ADSREcho.vst3
-            // We want: ADSREcho.vst3/Contents/x86_64-win/IRs
-            irFolder = pluginPath.getParentDirectory().getChildFile("IRs");
-            DBG("Windows: Looking in plugin folder");
-        #elif JUCE_MAC
-            // macOS VST3 structure:
-            // ADSREcho.vst3/Contents/MacOS/ADSREcho
-            // We want: ADSREcho.vst3/Contents/Resources/IRs
-            irFolder = pluginPath.getParentDirectory()
-                                 .getParentDirectory()
-                                 .getChildFile("Resources")
-                                 .getChildFile("IRs");
-            DBG("macOS: Looking in Resources folder");
-        #else
-            // Linux fallback
-            irFolder = pluginPath.getParentDirectory().getChildFile("IRs");
-            DBG("Linux: Looking in plugin folder");
-        #endif
-        
-        DBG("IR Folder: " + irFolder.getFullPathName());
-        DBG("Exists: " + juce::String(irFolder.exists() ? "YES" : "NO"));
-        DBG("Is Directory: " + juce::String(irFolder.isDirectory() ? "YES" : "NO"));
-        
-        // If not found in plugin bundle, try development location
-        if (!irFolder.exists())
-        {
-            DBG("Not found in plugin bundle, trying development location...");
-            
-            // Try to find Source/IRs by going up from plugin
-            auto searchDir = pluginPath.getParentDirectory();
-            
-            for (int i = 0; i < 10; ++i)
-            {
-                auto testFolder = searchDir.getChildFile("Source").getChildFile("IRs");
-                DBG("  Trying: " + testFolder.getFullPathName());
-                
-                if (testFolder.exists() && testFolder.isDirectory())
-                {
-                    irFolder = testFolder;
-                    DBG("  Found development IRs!");
-                    break;
-                }
-                
-                searchDir = searchDir.getParentDirectory();
-            }
-        }
-        
-        if (!irFolder.exists() || !irFolder.isDirectory())
-        {
-            DBG("X IR folder not found anywhere!");
-            DBG("  Expected location: " + irFolder.getFullPathName());
-            DBG("  Please run post-build script to copy IRs, or manually create this folder and add .wav files");
-            
-            // Add bypass only
-            IRInfo bypass;
-            bypass.name = "Bypass";
-            bypass.file = juce::File();
-            irList.push_back(bypass);
-            return;
-        }
-        
-        // Found the folder, scan for WAV files
-        DBG("Scanning for .wav files...");
-        
-        // Add bypass first
-        {
-            IRInfo bypass;
-            bypass.name = "Bypass";
-            bypass.file = juce::File();
-            irList.push_back(bypass);
-            DBG("  [0] Bypass");
-        }
-        
-        // Get all WAV files
-        juce::Array<juce::File> wavFiles;
-        irFolder.findChildFiles(wavFiles, 
-                               juce::File::findFiles, 
-                               false,  // not recursive
-                               "*.wav;*.WAV");
-        
-        // Sort alphabetically
-        struct FileSorter
-        {
-            static int compareElements(const juce::File& first, const juce::File& second)
-            {
-                return first.getFileName().compareNatural(second.getFileName());
-            }
-        };
-        
-        FileSorter sorter;
-        wavFiles.sort(sorter);
-        
-        DBG("Found " + juce::String(wavFiles.size()) + " WAV files");
-        
-        // Add each WAV file
-        for (const auto& file : wavFiles)
-        {
-            IRInfo info;
-            info.name = file.getFileNameWithoutExtension();
-            info.file = file;
-            irList.push_back(info);
-            
-            DBG("  [" + juce::String(irList.size()-1) + "] " + info.name);
-            DBG("      " + file.getFullPathName());
-        }
-        
-        DBG("Total IRs loaded: " + juce::String(irList.size()));
-        DBG("=============================");
-    }
-};
\ No newline at end of file
+        std::vector<IRInfo> irs;
+        std::shared_ptr<const IRPack> pack;
+    };
+
+    void run() override;
+    void discover();
+    void analyseAll();
+
+    std::shared_ptr<const Contents> getContents() const;
+    void publish(std::shared_ptr<const Contents> newContents);
+
+    // Swaps in a copy of the contents with one IR's analysis set
+    void publishAnalysis(int index, std::shared_ptr<const IRAnalysis::Summary> summary);
+
+    // Bypass plus every entry of the pack - replaces the folder scan
+    std::shared_ptr<const Contents> loadIRsFromPack(const juce::File& packFile) const;
+    std::shared_ptr<const Contents> loadIRsFromFolder(const juce::File& irFolder);
+
+    // The index element holding IR info's entry - the FOLDER entries
+    // discovery wrote, or (created if need be) one per IR pack
+    static juce::XmlElement* findIndexEntry(juce::XmlElement& index, const Contents& c,
+                                            const IRInfo& info, bool create);
+
+    static juce::File getIndexFile();
+    static std::unique_ptr<juce::XmlElement> loadIndex();
+    static IRInfo makeBypassInfo();
+
+    mutable juce::CriticalSection contentsLock;
+    std::shared_ptr<const Contents> contents;
+
+    std::atomic<bool> ready { false };
+    std::atomic<bool> analysisComplete { false };
+
+    juce::ListenerList<Listener, juce::Array<Listener*, juce::CriticalSection>> listeners;
+
+    juce::SharedResourcePointer<IRCache> irCache;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IRBank)
+};
@@ -0,0 +1,362 @@
+#include "IRCache.h"
+#include "IRAnalysis.h"
+#include "IRPack.h"
+
+#include <algorithm>
+
+IRCache::IRCache()
+    : diskDirectory(getUserDataDirectory().getChildFile("IRCache"))
+{
+    formatManager.registerBasicFormats();
+}
+
+juce::String IRCache::makeKey(const juce::File& file)
+{
+    // Modification time and size are part of the key so an edited file is
+    // decoded again instead of served stale
+    return file.getFullPathName()
+         + "|" + juce::String(file.getLastModificationTime().toMilliseconds())
+         + "|" + juce::String(file.getSize());
+}
+
+IRCache::IRPtr IRCache::getIR(const juce::File& file, double targetSampleRate)
+{
+    if (!file.existsAsFile())
+        return nullptr;
+
+    const auto sourceKey = makeKey(file);
+    const auto nativeKey = sourceKey + "|native";
+
+    // Decode at the file's own rate - served from the cache as well if some
+    // other caller already asked for it unresampled
+    auto getNative = [this, &file, &nativeKey]() -> IRPtr
+    {
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (auto cached = findAndTouch(nativeKey))
+                return cached;
+        }
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        auto native = decode(reader.get());
+
+        if (native == nullptr)
+            DBG("IRCache::getIR - ERROR: Could not read: " + file.getFullPathName());
+
+        return native;
+    };
+
+    if (targetSampleRate > 0.0)
+        return getResampled(sourceKey, targetSampleRate, getNative);
+
+    return findOrLoad(nativeKey, getNative);
+}
+
+IRCache::IRPtr IRCache::getResampled(const juce::String& sourceKey, double targetSampleRate,
+                                     const std::function<IRPtr()>& getSource)
+{
+    const auto key       = sourceKey + "|" + juce::String(targetSampleRate, 1);
+    const auto directory = getDiskCacheDirectory();
+
+    return findOrLoad(key, [&]() -> IRPtr
+    {
+        // Resampled in an earlier session (or by another instance)
+        if (auto stored = loadFromDisk(directory, sourceKey, targetSampleRate))
+            return stored;
+
+        auto source = getSource();
+
+        if (source == nullptr || source->sampleRate <= 0.0 || source->sampleRate == targetSampleRate)
+            return source;
+
+        auto resampled = resample(*source, targetSampleRate);
+
+        // Normalised and analysed on the way to disk; the mapped copy is what
+        // every caller gets from now on
+        if (auto stored = storeOnDisk(directory, sourceKey, resampled))
+            resampled = std::move(stored);
+
+        return resampled;
+    });
+}
+
+IRCache::IRPtr IRCache::decodeFromMemory(const void* data, size_t dataSize)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(
+        std::make_unique<juce::MemoryInputStream>(data, dataSize, false)));
+
+    return decode(reader.get());
+}
+
+IRCache::IRPtr IRCache::getOrCreate(const juce::String& key, const std::function<IRPtr()>& create)
+{
+    return findOrLoad(key, create);
+}
+
+IRCache::IRPtr IRCache::findOrLoad(const juce::String& key, const std::function<IRPtr()>& load)
+{
+    {
+        const juce::ScopedLock sl(lock);
+
+        while (inFlight.count(key) != 0)
+        {
+            // Signalled once per finished load, and several callers may be
+            // waiting on different keys - so poll as well
+            const juce::ScopedUnlock ul(lock);
+            loadFinished.wait(20);
+        }
+
+        if (auto cached = findAndTouch(key))
+            return cached;
+
+        inFlight.insert(key);
+    }
+
+    auto loaded = load();
+
+    {
+        const juce::ScopedLock sl(lock);
+        inFlight.erase(key);
+
+        if (loaded != nullptr)
+            insert(key, loaded);
+    }
+
+    loadFinished.signal();
+    return loaded;
+}
+
+IRCache::IRPtr IRCache::decode(juce::AudioFormatReader* reader)
+{
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return nullptr;
+
+    const int numChannels = (int)reader->numChannels == kMaxChannels ? kMaxChannels
+                                                                     : juce::jlimit(1, 2, (int)reader->numChannels);
+
+    auto ir = std::make_shared<DecodedIR>();
+    ir->buffer.setSize(numChannels, (int)reader->lengthInSamples);
+    reader->read(&ir->buffer, 0, ir->buffer.getNumSamples(), 0, true, numChannels > 1);
+    ir->sampleRate = reader->sampleRate;
+
+    // Stereo files with both sides identical (common for cabinet IRs) cost
+    // half the memory and FFT work as mono - the engine feeds every channel
+    // from the one spectrum
+    if (IRAnalysis::isDualMono(ir->buffer))
+        ir->buffer.setSize(1, ir->buffer.getNumSamples(), true);
+
+    return ir;
+}
+
+// Same resampling juce::dsp::Convolution used internally
+IRCache::IRPtr IRCache::resample(const DecodedIR& source, double destSampleRate)
+{
+    const double srcSampleRate = source.sampleRate;
+
+    if (srcSampleRate <= 0.0 || destSampleRate <= 0.0 || srcSampleRate == destSampleRate)
+    {
+        // Copies the samples - never hands out a view into someone's mapping
+        auto copy = std::make_shared<DecodedIR>();
+        copy->buffer     = source.buffer;
+        copy->sampleRate = source.sampleRate;
+        copy->normalised = source.normalised;
+        copy->trimPoint  = source.trimPoint;
+        return copy;
+    }
+
+    const auto& buf   = source.buffer;
+    const auto factor = srcSampleRate / destSampleRate;
+
+    auto ir = std::make_shared<DecodedIR>();
+    ir->sampleRate = destSampleRate;
+    ir->buffer.setSize(buf.getNumChannels(), (int)std::ceil(buf.getNumSamples() / factor));
+
+    juce::MemoryAudioSource memorySource(const_cast<juce::AudioBuffer<float>&>(buf), false);
+    juce::ResamplingAudioSource resamplingSource(&memorySource, false, buf.getNumChannels());
+
+    resamplingSource.setResamplingRatio(factor);
+    resamplingSource.prepareToPlay(buf.getNumSamples(), destSampleRate);
+
+    juce::AudioSourceChannelInfo info;
+    info.buffer      = &ir->buffer;
+    info.startSample = 0;
+    info.numSamples  = ir->buffer.getNumSamples();
+    resamplingSource.getNextAudioBlock(info);
+
+    return ir;
+}
+
+IRCache::IRPtr IRCache::loadFromDisk(const juce::File& directory, const juce::String& sourceKey, double sampleRate)
+{
+    const auto file = getDiskFile(directory, sourceKey, sampleRate);
+
+    if (!file.existsAsFile())
+        return nullptr;
+
+    auto pack = IRPack::open(file);
+
+    if (pack == nullptr || pack->getNumIRs() != 1)
+    {
+        // Left by an older version or cut short - written again below
+        file.deleteFile();
+        return nullptr;
+    }
+
+    auto ir = pack->getIR(0, sampleRate);
+
+    if (ir == nullptr || ir->sampleRate != sampleRate)
+        return nullptr;
+
+    // Recently used entries survive trimDiskCache
+    file.setLastAccessTime(juce::Time::getCurrentTime());
+    return ir;
+}
+
+IRCache::IRPtr IRCache::storeOnDisk(const juce::File& directory, const juce::String& sourceKey, const IRPtr& ir)
+{
+    const auto file = getDiskFile(directory, sourceKey, ir->sampleRate);
+
+    if (file == juce::File() || !file.getParentDirectory().createDirectory())
+        return nullptr;
+
+    // Written beside the target and moved over it, so another instance never
+    // maps half a file
+    juce::TemporaryFile temp(file);
+
+    if (!IRPack::writeSingle(ir, temp.getFile()) || !temp.overwriteTargetFileWithTemporary())
+    {
+        DBG("IRCache - Could not write " + file.getFullPathName());
+        return nullptr;
+    }
+
+    trimDiskCache(directory);
+
+    return loadFromDisk(directory, sourceKey, ir->sampleRate);
+}
+
+juce::File IRCache::getDiskFile(const juce::File& directory, const juce::String& sourceKey, double sampleRate)
+{
+    if (directory == juce::File())
+        return {};
+
+    return directory.getChildFile(juce::String::toHexString(sourceKey.hashCode64())
+                                      + "_" + juce::String(juce::roundToInt(sampleRate))
+                                      + ".irpack");
+}
+
+void IRCache::trimDiskCache(const juce::File& directory)
+{
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.irpack");
+
+    juce::int64 total = 0;
+    for (const auto& f : files)
+        total += f.getSize();
+
+    if (total <= kDefaultDiskBudget)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const juce::File& a, const juce::File& b)
+    {
+        return a.getLastAccessTime() < b.getLastAccessTime();
+    });
+
+    // Oldest first. A file still mapped somewhere may refuse to go (Windows)
+    // and is simply tried again next time.
+    for (const auto& f : files)
+    {
+        if (total <= kDefaultDiskBudget)
+            break;
+
+        const auto size = f.getSize();
+
+        if (f.deleteFile())
+            total -= size;
+    }
+}
+
+void IRCache::setDiskCacheDirectory(const juce::File& directory)
+{
+    const juce::ScopedLock sl(lock);
+    diskDirectory = directory;
+}
+
+juce::File IRCache::getDiskCacheDirectory() const
+{
+    const juce::ScopedLock sl(lock);
+    return diskDirectory;
+}
+
+juce::File IRCache::getUserDataDirectory()
+{
+    auto dir = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
+
+   #if JUCE_MAC
+    dir = dir.getChildFile("Application Support");
+   #endif
+
+    return dir.getChildFile("ADSREcho");
+}
+
+IRCache::IRPtr IRCache::findAndTouch(const juce::String& key)
+{
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        if (it->key == key)
+        {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().ir;
+        }
+    }
+
+    return nullptr;
+}
+
+void IRCache::insert(const juce::String& key, IRPtr ir)
+{
+    memoryUsage += ir->getSizeInBytes();
+    entries.push_front({ key, std::move(ir) });
+
+    evictUnused(memoryBudget);
+}
+
+void IRCache::evictUnused(size_t targetBytes)
+{
+    // Walk from the least recently used end; use_count() == 1 means only the
+    // cache is still holding the entry
+    for (auto it = entries.end(); it != entries.begin() && memoryUsage > targetBytes;)
+    {
+        --it;
+
+        if (it->ir.use_count() == 1)
+        {
+            memoryUsage -= it->ir->getSizeInBytes();
+            it = entries.erase(it);
+        }
+    }
+}
+
+void IRCache::setMemoryBudget(size_t bytes)
+{
+    const juce::ScopedLock sl(lock);
+    memoryBudget = bytes;
+    evictUnused(memoryBudget);
+}
+
+size_t IRCache::getMemoryBudget() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryBudget;
+}
+
+size_t IRCache::getMemoryUsage() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryUsage;
+}
+
+void IRCache::purgeUnused()
+{
+    const juce::ScopedLock sl(lock);
+    evictUnused(0);
+}
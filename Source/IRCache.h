@@ -0,0 +1,149 @@
+// IRCache.h - Process-wide cache of decoded impulse responses
+//
+// Decoding and resampling an IR is the slow part of switching it, and every
+// convolution slot in every plugin instance used to do it again for the same
+// file. IRCache is held through juce::SharedResourcePointer, so all of them
+// share one copy per (file, sample rate). Entries are handed out as shared
+// pointers to immutable data; anything not referenced outside the cache is
+// evicted least-recently-used first once the memory budget is exceeded.
+//
+// Resampled IRs are also kept on disk, in the user's ADSREcho folder, as
+// one-entry IR packs (see IRPack.h) - normalised, with their trim point. A
+// later session at the same rate maps the file instead of resampling again.
+//
+// The lock only covers the table. Decoding, resampling and disk traffic run
+// outside it, so callers after different IRs don't queue behind each other;
+// a second caller after the same one waits for the first one's result.
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_core/juce_core.h>
+  #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_audio_formats/juce_audio_formats.h>
+#endif
+
+#include <functional>
+#include <list>
+#include <set>
+
+class IRCache
+{
+public:
+    struct DecodedIR
+    {
+        juce::AudioBuffer<float> buffer;
+        double sampleRate = 0.0;    // 0 = rate independent, never resampled
+
+        // Set for IRs served straight out of an IRPack: buffer refers to the
+        // mapped file, which backing keeps alive
+        std::shared_ptr<const void> backing;
+        bool normalised = false;    // already at the engine's reference level
+        int  trimPoint  = -1;       // precomputed at the default floor, -1 = unknown
+
+        // Mapped IRs are file-backed pages the OS can drop, so they count 0
+        // against the memory budget - what bounds them is the disk budget
+        // (cached resamples) and the IR packs installed
+        size_t getSizeInBytes() const
+        {
+            if (backing != nullptr)
+                return 0;
+
+            return sizeof(float) * (size_t)buffer.getNumChannels() * (size_t)buffer.getNumSamples();
+        }
+    };
+
+    using IRPtr = std::shared_ptr<const DecodedIR>;
+
+    // Mono, stereo, or true stereo (LL, LR, RL, RR - see PartitionedConvolver).
+    // Files with three or more than four channels are read as stereo.
+    static constexpr int kMaxChannels = 4;
+
+    static constexpr size_t kDefaultMemoryBudget = 256 * 1024 * 1024;
+
+    // Least recently used files are deleted past this
+    static constexpr juce::int64 kDefaultDiskBudget = (juce::int64) 1024 * 1024 * 1024;
+
+    IRCache();
+
+    // Decoded IR for file, resampled to targetSampleRate (0 = keep the file's
+    // rate). Returns nullptr if the file can't be read. Blocks while decoding -
+    // never call from the audio thread.
+    IRPtr getIR(const juce::File& file, double targetSampleRate);
+
+    // Decodes an in-memory audio file. Not cached - there is no stable key.
+    IRPtr decodeFromMemory(const void* data, size_t dataSize);
+
+    // Entry stored under key, or whatever create() returns (stored if not null).
+    // For IRs that don't come from a plain file.
+    IRPtr getOrCreate(const juce::String& key, const std::function<IRPtr()>& create);
+
+    // The IR getSource() returns, resampled to targetSampleRate - from memory,
+    // then from the disk cache, otherwise resampled and written there.
+    // sourceKey must name the source across sessions (path, size and
+    // modification time, say); getSource is only called on a miss.
+    IRPtr getResampled(const juce::String& sourceKey, double targetSampleRate,
+                       const std::function<IRPtr()>& getSource);
+
+    // Unreferenced entries beyond the budget are evicted, oldest first.
+    // Entries still in use never are, so the budget can be exceeded. Only
+    // decoded (heap) IRs count towards it; mapped ones are 0 bytes here.
+    void   setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+    size_t getMemoryUsage()  const;
+
+    // Drops every entry nobody else is holding
+    void purgeUnused();
+
+    // Where the disk cache lives; an invalid File turns it off
+    void       setDiskCacheDirectory(const juce::File& directory);
+    juce::File getDiskCacheDirectory() const;
+
+    static IRPtr resample(const DecodedIR& source, double destSampleRate);
+
+    // The per-user ADSREcho folder (application data; Application Support
+    // on macOS)
+    static juce::File getUserDataDirectory();
+
+private:
+    struct Entry
+    {
+        juce::String key;
+        IRPtr ir;
+    };
+
+    static juce::String makeKey(const juce::File& file);
+
+    IRPtr decode(juce::AudioFormatReader* reader);
+    static IRPtr loadFromDisk(const juce::File& directory, const juce::String& sourceKey, double sampleRate);
+    static IRPtr storeOnDisk (const juce::File& directory, const juce::String& sourceKey, const IRPtr& ir);
+    static juce::File getDiskFile(const juce::File& directory, const juce::String& sourceKey, double sampleRate);
+    static void trimDiskCache(const juce::File& directory);
+
+    // The entry under key, or what load() returns (stored if not null), run
+    // without the lock. One load per key at a time - other callers for it
+    // wait and take the result.
+    IRPtr findOrLoad(const juce::String& key, const std::function<IRPtr()>& load);
+
+    // With the lock held
+    IRPtr findAndTouch(const juce::String& key);
+    void  insert(const juce::String& key, IRPtr ir);
+    void  evictUnused(size_t targetBytes);
+
+    juce::CriticalSection lock;
+    juce::AudioFormatManager formatManager;   // registered once, then only read
+
+    std::list<Entry> entries;   // most recently used at the front
+    size_t memoryUsage  = 0;
+    size_t memoryBudget = kDefaultMemoryBudget;
+
+    // Keys some caller is loading right now, and signalled as each finishes
+    std::set<juce::String> inFlight;
+    juce::WaitableEvent loadFinished;
+
+    juce::File diskDirectory;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IRCache)
+};
@@ -0,0 +1,255 @@
+#include "IRPack.h"
+#include "IRAnalysis.h"
+
+#include <cstring>
+#include <map>
+
+namespace
+{
+    constexpr juce::uint64 kAlignment = 64;
+
+    juce::uint64 alignUp(juce::uint64 n) { return (n + kAlignment - 1) & ~(kAlignment - 1); }
+}
+
+IRPack::IRPack(std::unique_ptr<juce::MemoryMappedFile> mappedFile)
+    : map(std::move(mappedFile))
+{
+    const auto* base = static_cast<const char*>(map->getData());
+    const auto  size = (juce::uint64) map->getSize();
+
+    if (base == nullptr || size < sizeof(FileHeader))
+        return;
+
+    const auto* h = reinterpret_cast<const FileHeader*>(base);
+
+    if (h->magic != kMagic || h->version != kVersion
+        || h->numRates == 0 || h->numRates > (juce::uint32) kMaxRates
+        || sizeof(FileHeader) + (juce::uint64) h->numIRs * sizeof(IREntry) > size)
+        return;
+
+    const auto* e = reinterpret_cast<const IREntry*>(base + sizeof(FileHeader));
+
+    // Every plane must lie inside the file before anything points into it
+    for (juce::uint32 i = 0; i < h->numIRs; ++i)
+    {
+        if (e[i].numChannels == 0 || e[i].numChannels > (juce::uint32) IRCache::kMaxChannels)
+            return;
+
+        for (juce::uint32 r = 0; r < h->numRates; ++r)
+        {
+            const auto& re  = e[i].rates[r];
+            const auto  end = re.dataOffset
+                            + (juce::uint64) re.channelStride * e[i].numChannels * sizeof(float);
+
+            if (re.dataOffset % kAlignment != 0 || re.numSamples == 0
+                || re.channelStride < re.numSamples || end > size)
+                return;
+        }
+    }
+
+    header  = h;
+    entries = e;
+
+    // Views share ownership of the mapping, so an IR in use outlives the pack
+    std::shared_ptr<const void> backing = map;
+
+    views.reserve((size_t) h->numIRs * h->numRates);
+
+    for (juce::uint32 i = 0; i < h->numIRs; ++i)
+    {
+        for (juce::uint32 r = 0; r < h->numRates; ++r)
+        {
+            const auto& re = e[i].rates[r];
+
+            // The mapping is read-only; the buffer is only ever read through
+            // the const DecodedIR it lives in
+            float* channels[IRCache::kMaxChannels] = {};
+            for (juce::uint32 ch = 0; ch < e[i].numChannels; ++ch)
+                channels[ch] = const_cast<float*>(reinterpret_cast<const float*>(
+                    base + re.dataOffset + (juce::uint64) ch * re.channelStride * sizeof(float)));
+
+            auto ir = std::make_shared<IRCache::DecodedIR>();
+            ir->buffer.setDataToReferTo(channels, (int) e[i].numChannels, (int) re.numSamples);
+            ir->sampleRate = h->rates[r];
+            ir->backing    = backing;
+            ir->normalised = true;
+            ir->trimPoint  = (int) re.trimPoint;
+
+            views.push_back(std::move(ir));
+        }
+    }
+}
+
+std::shared_ptr<const IRPack> IRPack::open(const juce::File& file)
+{
+    static juce::CriticalSection registryLock;
+    static std::map<juce::String, std::weak_ptr<const IRPack>> registry;
+
+    if (!file.existsAsFile())
+        return nullptr;
+
+    const juce::ScopedLock sl(registryLock);
+
+    // Same key as the pack's identity, so a pack rewritten in place maps
+    // afresh instead of handing back the old file's contents
+    const auto key = file.getFullPathName() + "|" + juce::String(file.getSize())
+                   + "|" + juce::String(file.getLastModificationTime().toMilliseconds());
+
+    // Drop entries whose pack is gone - old versions of rewritten packs would
+    // otherwise pile up for the life of the process
+    for (auto it = registry.begin(); it != registry.end();)
+        it = it->second.expired() ? registry.erase(it) : std::next(it);
+
+    if (auto it = registry.find(key); it != registry.end())
+        if (auto existing = it->second.lock())
+            return existing;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    std::shared_ptr<IRPack> pack(new IRPack(std::move(mapped)));
+
+    if (!pack->isValid())
+    {
+        DBG("IRPack::open - ERROR: Not a valid IR pack: " + file.getFullPathName());
+        return nullptr;
+    }
+
+    pack->identity = key;
+
+    registry[key] = pack;
+    return pack;
+}
+
+juce::String IRPack::getName(int index) const
+{
+    if (!juce::isPositiveAndBelow(index, getNumIRs()))
+        return {};
+
+    const auto& name = entries[index].name;
+    return juce::String::fromUTF8(name, (int) strnlen(name, sizeof(name)));
+}
+
+IRCache::IRPtr IRPack::getIR(int index, double sampleRate) const
+{
+    if (!juce::isPositiveAndBelow(index, getNumIRs()))
+        return nullptr;
+
+    // Closest packed rate - exact for the usual 44.1/48/96 kHz sessions; the
+    // caller resamples from here otherwise
+    int best = 0;
+    for (int r = 1; r < (int) header->numRates; ++r)
+        if (std::abs(header->rates[r] - sampleRate) < std::abs(header->rates[best] - sampleRate))
+            best = r;
+
+    return views[(size_t) index * header->numRates + (size_t) best];
+}
+
+bool IRPack::write(const juce::Array<juce::File>& sources,
+                   const juce::Array<double>& sampleRates,
+                   const juce::File& destination)
+{
+    juce::SharedResourcePointer<IRCache> cache;
+
+    juce::StringArray names;
+    for (const auto& source : sources)
+        names.add(source.getFileNameWithoutExtension());
+
+    return writeEntries(names, [&sources, &cache](int i) -> IRCache::IRPtr
+    {
+        // Only needed while one IR is being packed
+        cache->purgeUnused();
+
+        auto native = cache->getIR(sources[i], 0.0);
+
+        if (native == nullptr)
+            DBG("IRPack::write - ERROR: Could not read: " + sources[i].getFullPathName());
+
+        return native;
+    }, sampleRates, destination);
+}
+
+bool IRPack::writeSingle(const IRCache::IRPtr& ir, const juce::File& destination)
+{
+    if (ir == nullptr || ir->sampleRate <= 0.0)
+        return false;
+
+    return writeEntries({ "IR" }, [&ir](int) { return ir; }, { ir->sampleRate }, destination);
+}
+
+bool IRPack::writeEntries(const juce::StringArray& names,
+                          const std::function<IRCache::IRPtr(int)>& getSource,
+                          const juce::Array<double>& sampleRates,
+                          const juce::File& destination)
+{
+    if (names.isEmpty() || sampleRates.isEmpty() || sampleRates.size() > kMaxRates)
+        return false;
+
+    FileHeader fileHeader {};
+    fileHeader.magic    = kMagic;
+    fileHeader.version  = kVersion;
+    fileHeader.numIRs   = (juce::uint32) names.size();
+    fileHeader.numRates = (juce::uint32) sampleRates.size();
+
+    for (int r = 0; r < sampleRates.size(); ++r)
+        fileHeader.rates[r] = sampleRates[r];
+
+    std::vector<IREntry> irEntries((size_t) names.size());
+
+    destination.deleteFile();
+    juce::FileOutputStream out(destination);
+
+    if (out.failedToOpen())
+        return false;
+
+    // Sample data goes after the entry table, which is written last
+    juce::uint64 position = alignUp(sizeof(FileHeader) + irEntries.size() * sizeof(IREntry));
+
+    for (int i = 0; i < names.size(); ++i)
+    {
+        auto& entry = irEntries[(size_t) i];
+
+        auto native = getSource(i);
+        if (native == nullptr)
+            return false;
+
+        names[i].copyToUTF8(entry.name, sizeof(entry.name));
+
+        entry.numChannels      = (juce::uint32) native->buffer.getNumChannels();
+        entry.sourceSampleRate = native->sampleRate;
+        entry.peak             = native->buffer.getMagnitude(0, native->buffer.getNumSamples())
+                               * IRAnalysis::getNormalisationGain(native->buffer);
+
+        for (int r = 0; r < sampleRates.size(); ++r)
+        {
+            auto resampled = IRCache::resample(*native, sampleRates[r]);
+
+            // Normalised per rate - the same level Convolution would produce
+            auto buffer = resampled->buffer;
+            buffer.applyGain(IRAnalysis::getNormalisationGain(buffer));
+
+            auto& re         = entry.rates[r];
+            re.dataOffset    = position;
+            re.numSamples    = (juce::uint32) buffer.getNumSamples();
+            re.channelStride = (juce::uint32) (alignUp((juce::uint64) buffer.getNumSamples() * sizeof(float))
+                                               / sizeof(float));
+            re.trimPoint     = (juce::uint32) IRAnalysis::findTrimPoint(buffer, IRAnalysis::kDefaultTrimFloorDb);
+
+            out.setPosition((juce::int64) position);
+
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                out.write(buffer.getReadPointer(ch), (size_t) buffer.getNumSamples() * sizeof(float));
+
+                out.writeRepeatedByte(0, (size_t) (re.channelStride - re.numSamples) * sizeof(float));
+            }
+
+            position += (juce::uint64) re.channelStride * entry.numChannels * sizeof(float);
+        }
+    }
+
+    out.setPosition(0);
+    out.write(&fileHeader, sizeof(fileHeader));
+    out.write(irEntries.data(), irEntries.size() * sizeof(IREntry));
+    out.flush();
+
+    return !out.getStatus().failed();
+}
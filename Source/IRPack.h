@@ -0,0 +1,105 @@
+// IRPack.h - Memory-mapped archive of pre-processed impulse responses
+//
+// One file replaces the folder of bundled WAVs. Every IR is stored already
+// normalised, as float32 at each of a handful of common sample rates, together
+// with its trim point at the default decay floor, so loading one is a pointer
+// lookup into the mapping instead of a decode.
+//
+// Layout (little-endian):
+//
+//   FileHeader                      magic, version, counts, packed rates
+//   IREntry[numIRs]                 name, metadata, one RateEntry per rate
+//   ...                             sample data, each channel plane 64-byte
+//                                   aligned, channelStride floats apart
+
+#pragma once
+
+#include "IRCache.h"
+
+class IRPack
+{
+public:
+    static constexpr juce::uint32 kMagic    = 0x4B505249;  // "IRPK"
+    static constexpr juce::uint32 kVersion  = 1;
+    static constexpr int          kMaxRates = 8;
+    static constexpr int          kMaxNameBytes = 96;
+
+    struct FileHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 numIRs;
+        juce::uint32 numRates;
+        double       rates[kMaxRates];
+    };
+
+    struct RateEntry
+    {
+        juce::uint64 dataOffset;        // from the start of the file
+        juce::uint32 numSamples;
+        juce::uint32 channelStride;     // floats between channel planes
+        juce::uint32 trimPoint;         // at IRAnalysis::kDefaultTrimFloorDb
+        juce::uint32 reserved;
+    };
+
+    struct IREntry
+    {
+        char         name[kMaxNameBytes];   // UTF-8, null terminated
+        juce::uint32 numChannels;
+        float        peak;                  // after normalisation, at the source rate
+        double       sourceSampleRate;
+        RateEntry    rates[kMaxRates];
+    };
+
+    static_assert(sizeof(FileHeader) == 80,  "IRPack header layout changed");
+    static_assert(sizeof(RateEntry)  == 24,  "IRPack rate entry layout changed");
+    static_assert(sizeof(IREntry)    == 304, "IRPack IR entry layout changed");
+
+    // Maps file, or returns nullptr if it is missing or not a valid pack. Packs
+    // are shared process-wide by path, so every IRBank - and every kernel built
+    // from a pack IR - sees the same IR objects.
+    static std::shared_ptr<const IRPack> open(const juce::File& file);
+
+    int          getNumIRs()       const { return (int) header->numIRs; }
+    juce::String getName(int index) const;
+
+    // Path, size and modification time of the file - names this pack's
+    // contents across sessions, until it is rebuilt
+    const juce::String& getIdentity() const { return identity; }
+
+    // The IR at the packed rate closest to sampleRate - a view into the mapping,
+    // no samples are copied. nullptr if index is out of range.
+    IRCache::IRPtr getIR(int index, double sampleRate) const;
+
+    // Decodes, normalises, resamples and analyses every source file and writes
+    // the archive. Used by the IRPackBuilder tool, not by the plugin.
+    static bool write(const juce::Array<juce::File>& sources,
+                      const juce::Array<double>& sampleRates,
+                      const juce::File& destination);
+
+    // A one-entry pack holding ir at its own rate, normalised and analysed
+    // the same way. IRCache's disk entries.
+    static bool writeSingle(const IRCache::IRPtr& ir, const juce::File& destination);
+
+private:
+    explicit IRPack(std::unique_ptr<juce::MemoryMappedFile> mappedFile);
+
+    // getSource(i) decodes IR i at its own rate; every rate is resampled from it
+    static bool writeEntries(const juce::StringArray& names,
+                             const std::function<IRCache::IRPtr(int)>& getSource,
+                             const juce::Array<double>& sampleRates,
+                             const juce::File& destination);
+
+    bool isValid() const { return header != nullptr; }
+
+    std::shared_ptr<juce::MemoryMappedFile> map;
+    juce::String identity;
+    const FileHeader* header  = nullptr;
+    const IREntry*    entries = nullptr;
+
+    // [index * numRates + rate] - built once so every caller gets the same
+    // object for the same IR (KernelCache keys on identity)
+    std::vector<IRCache::IRPtr> views;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IRPack)
+};
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    ModuleMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "ModuleMeter.h"
+
+namespace
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    // Scalar up to the first aligned sample, then a register at a time
+    float sumOfSquares(const float* data, int numSamples) noexcept
+    {
+        float sum = 0.0f;
+        int i = 0;
+
+        for (; i < numSamples && !Vec::isSIMDAligned(data + i); ++i)
+            sum += data[i] * data[i];
+
+        Vec accumulator = Vec::expand(0.0f);
+
+        for (; i + (int) Vec::size() <= numSamples; i += (int) Vec::size())
+        {
+            const Vec v = Vec::fromRawArray(data + i);
+            accumulator += v * v;
+        }
+
+        sum += accumulator.sum();
+
+        for (; i < numSamples; ++i)
+            sum += data[i] * data[i];
+
+        return sum;
+    }
+}
+
+void ModuleMeter::measure(const juce::AudioBuffer<float>& buffer, float& peak, float& rms) noexcept
+{
+    const int numChannels = buffer.getNumChannels();
+    const int numSamples  = buffer.getNumSamples();
+
+    peak = 0.0f;
+    rms  = 0.0f;
+
+    if (numChannels == 0 || numSamples == 0)
+        return;
+
+    float squares = 0.0f;
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const float* data = buffer.getReadPointer(ch);
+        const auto range  = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+
+        peak = juce::jmax(peak, -range.getStart(), range.getEnd());
+        squares += sumOfSquares(data, numSamples);
+    }
+
+    rms = std::sqrt(squares / (float) (numChannels * numSamples));
+}
+
+void ModuleMeter::measureInput(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    measure(buffer, pending.inputPeak, pending.inputRms);
+}
+
+void ModuleMeter::measureOutput(const juce::AudioBuffer<float>& buffer) noexcept
+{
+    measure(buffer, pending.outputPeak, pending.outputRms);
+}
+
+void ModuleMeter::setGainReduction(float reductionDb, float detectorDb) noexcept
+{
+    pending.hasGainReduction = true;
+    pending.gainReductionDb  = reductionDb;
+    pending.detectorDb       = detectorDb;
+}
+
+void ModuleMeter::publish() noexcept
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 > 0)
+    {
+        ring[(size_t) start1] = pending;
+        fifo.finishedWrite(1);
+    }
+
+    pending.hasGainReduction = false;
+}
+
+void ModuleMeter::attach()
+{
+    // Anything still queued is from the last time someone was looking
+    if (numAttached.fetch_add(1) == 0)
+    {
+        Reading stale;
+        read(stale);
+    }
+}
+
+void ModuleMeter::detach()
+{
+    numAttached.fetch_sub(1);
+}
+
+bool ModuleMeter::read(Reading& result)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+    const int numReadings = size1 + size2;
+
+    if (numReadings == 0)
+        return false;
+
+    Reading folded;
+    float inputSquares = 0.0f, outputSquares = 0.0f;
+
+    auto fold = [&](const Reading& r)
+    {
+        folded.inputPeak  = juce::jmax(folded.inputPeak,  r.inputPeak);
+        folded.outputPeak = juce::jmax(folded.outputPeak, r.outputPeak);
+        inputSquares  += r.inputRms  * r.inputRms;
+        outputSquares += r.outputRms * r.outputRms;
+
+        if (r.hasGainReduction)
+        {
+            folded.hasGainReduction = true;
+            folded.gainReductionDb  = juce::jmin(folded.gainReductionDb, r.gainReductionDb);
+            folded.detectorDb       = juce::jmax(folded.detectorDb, r.detectorDb);
+        }
+    };
+
+    for (int i = 0; i < size1; ++i)
+        fold(ring[(size_t) (start1 + i)]);
+
+    for (int i = 0; i < size2; ++i)
+        fold(ring[(size_t) (start2 + i)]);
+
+    fifo.finishedRead(numReadings);
+
+    folded.inputRms  = std::sqrt(inputSquares  / (float) numReadings);
+    folded.outputRms = std::sqrt(outputSquares / (float) numReadings);
+
+    result = folded;
+    return true;
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    ModuleMeter.h
+    Per-slot level metering, audio thread to editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_core/juce_core.h>
+  #include <juce_dsp/juce_dsp.h>
+#endif
+
+// Every ModuleSlot owns one. While an editor is attached the slot measures
+// its buffer either side of the module each block - peak and RMS, plus gain
+// reduction from modules that have it - and publishes one Reading per block
+// into a lock-free single-producer / single-consumer ring. With nothing
+// attached the audio thread's whole cost is one atomic load.
+class ModuleMeter
+{
+public:
+    struct Reading
+    {
+        // Linear. Peak is the loudest channel's, RMS is over all channels.
+        float inputPeak  = 0.0f;
+        float inputRms   = 0.0f;
+        float outputPeak = 0.0f;
+        float outputRms  = 0.0f;
+
+        // Only meaningful when hasGainReduction (see EffectModule::getGainReduction)
+        bool  hasGainReduction = false;
+        float gainReductionDb  = 0.0f;      // <= 0
+        float detectorDb       = -100.0f;
+    };
+
+    static constexpr int ringSize = 64;     // blocks
+
+    // ----- Audio thread -----
+    bool isActive() const noexcept { return numAttached.load(std::memory_order_relaxed) > 0; }
+
+    void measureInput(const juce::AudioBuffer<float>& buffer) noexcept;
+    void measureOutput(const juce::AudioBuffer<float>& buffer) noexcept;
+    void setGainReduction(float reductionDb, float detectorDb) noexcept;
+
+    // Queues this block's reading; dropped if the editor has fallen behind
+    void publish() noexcept;
+
+    // ----- Message thread (the one reader) -----
+    void attach();
+    void detach();
+
+    // Folds every reading published since the last call into result - peaks
+    // and gain reduction at their extremes, RMS over the span. False if
+    // there were none.
+    bool read(Reading& result);
+
+private:
+    static void measure(const juce::AudioBuffer<float>& buffer, float& peak, float& rms) noexcept;
+
+    Reading pending;
+
+    juce::AbstractFifo fifo { ringSize };
+    std::array<Reading, ringSize> ring;
+
+    std::atomic<int> numAttached { 0 };
+};
@@ -26,6 +26,7 @@
 #endif
 
 #include "EffectModule.h"
+#include "ModuleMeter.h"
 
 class ModuleSlot
 {
@@ -47,19 +48,59 @@ public:
     {
         if (auto* m = activeModule.load(std::memory_order_acquire))
         {
+            const bool metering = meter.isActive();
+
+            if (metering)
+                meter.measureInput(buffer);
+
             m->setPlayHead(playHead);
             m->process(buffer, midi);
+
+            if (metering)
+            {
+                float reductionDb, detectorDb;
+
+                if (m->getGainReduction(reductionDb, detectorDb))
+                    meter.setGainReduction(reductionDb, detectorDb);
+
+                meter.measureOutput(buffer);
+                meter.publish();
+            }
         }
 
     }
 
+    int getLatencySamples() const
+    {
+        if (auto* m = activeModule.load(std::memory_order_acquire))
+            return m->getLatencySamples();
+
+        return 0;
+    }
+
+    void updateLatency()
+    {
+        if (auto* m = activeModule.load(std::memory_order_acquire))
+            m->updateLatency();
+    }
+
+    void setNonRealtime(bool isNonRealtime)
+    {
+        nonRealtime = isNonRealtime;
+
+        if (auto* m = activeModule.load(std::memory_order_acquire))
+            m->setNonRealtime(isNonRealtime);
+    }
+
     void setModule(std::unique_ptr<EffectModule> newModule)
     {
         if (newModule)
         {
+            // ID first - prepare() may read the slot's parameters
+            newModule->setID(slotID);
+            newModule->setNonRealtime(nonRealtime);
             if (currentSpec.sampleRate > 0)
                 newModule->prepare(currentSpec);
-            newModule->setID(slotID);
         }
 
         // Keep old module alive until after swap
@@ -86,8 +127,12 @@ public:
     juce::String slotID;
     bool bypassed = false;
 
+    // Input / output levels either side of the module, for the slot editor
+    ModuleMeter meter;
+
 private:
     juce::dsp::ProcessSpec currentSpec{};
+    bool nonRealtime = false;
 
     std::unique_ptr<EffectModule> ownedModule;
     std::unique_ptr<EffectModule> pendingDeletion;
@@ -0,0 +1,1286 @@
+#include "PartitionedConvolver.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#if !JUCE_WINDOWS
+ #include <sys/mman.h>
+ #include <unistd.h>
+#endif
+
+namespace
+{
+    // jobLate: past its deadline before the worker started it - only its
+    // input is entered into the delay line. jobDiscarded: given up on (past
+    // its deadline while running, or cancelled) - the worker drops it and
+    // goes back to idle.
+    enum JobStatus : int { jobIdle = 0, jobPending, jobRunning, jobDone, jobLate, jobDiscarded };
+
+    int divCeil(int a, int b) { return (a + b - 1) / b; }
+
+    int log2OfPowerOfTwo(int n)
+    {
+        int order = 0;
+        while ((1 << order) < n)
+            ++order;
+        return order;
+    }
+
+    // acc += a * b over numBins interleaved (re, im) pairs
+    void complexMultiplyAccumulate(float* acc, const float* a, const float* b, int numBins) noexcept
+    {
+        for (int k = 0; k < numBins; ++k)
+        {
+            const float ar = a[2 * k], ai = a[2 * k + 1];
+            const float br = b[2 * k], bi = b[2 * k + 1];
+
+            acc[2 * k]     += ar * br - ai * bi;
+            acc[2 * k + 1] += ar * bi + ai * br;
+        }
+    }
+
+    // IR channel that carries input channel in to output channel out, or -1
+    // if that pair isn't convolved. True stereo runs all four pairs; otherwise
+    // each channel only reaches itself (mono IRs feeding every channel).
+    int irChannelFor(const PartitionedConvolver::Kernel& k, bool trueStereo, int in, int out) noexcept
+    {
+        if (trueStereo)
+            return in * 2 + out;
+
+        return in == out ? juce::jmin(in, k.numChannels - 1) : -1;
+    }
+
+    // Streamed stage spectra on disk. Unmapped before the file is deleted,
+    // which Windows insists on.
+    struct SpillFile
+    {
+        ~SpillFile()
+        {
+            map.reset();
+            file.deleteFile();
+        }
+
+        juce::File file;
+        std::unique_ptr<juce::MemoryMappedFile> map;
+    };
+}
+
+//==============================================================================
+// ConvolutionWorker
+//==============================================================================
+
+ConvolutionWorker::ConvolutionWorker()
+    : ConvolutionWorker("Convolution Tail Worker", juce::Thread::Priority::high, false)
+{
+}
+
+ConvolutionWorker::ConvolutionWorker(const juce::String& threadName, juce::Thread::Priority priority,
+                                     bool runsStreamedStages)
+    : juce::Thread(threadName),
+      streamedStages(runsStreamedStages)
+{
+    startThread(priority);
+}
+
+ConvolutionWorker::~ConvolutionWorker()
+{
+    stopThread(2000);
+}
+
+void ConvolutionWorker::addEngine(PartitionedConvolver* engine)
+{
+    const juce::ScopedLock sl(lock);
+    engines.addIfNotAlreadyThere(engine);
+}
+
+void ConvolutionWorker::removeEngine(PartitionedConvolver* engine)
+{
+    const juce::ScopedLock sl(lock);
+    engines.removeFirstMatchingValue(engine);
+}
+
+void ConvolutionWorker::run()
+{
+    while (!threadShouldExit())
+    {
+        // The audio thread only raises a flag, so it is polled - a millisecond
+        // is well inside the shortest deadline a worker stage has
+        if (!runRequested.exchange(false, std::memory_order_acquire))
+        {
+            wait(1);
+            continue;
+        }
+
+        const juce::ScopedLock sl(lock);
+
+        runJobs(std::numeric_limits<int>::max());
+
+        // The resident worker also frees whatever finished crossfading, so a
+        // kernel still waiting in pendingState can swap in next block
+        if (!streamedStages)
+            for (auto* engine : engines)
+                engine->collectRetiredState();
+    }
+}
+
+void ConvolutionWorker::runJobs(int belowPartitionSize)
+{
+    // A long job stops every so often to run the shorter ones posted
+    // meanwhile, across all engines - their deadlines are closer
+    for (auto* engine : engines)
+        engine->runPendingJobs(streamedStages, belowPartitionSize,
+                               [this](int partitionSize) { runJobs(partitionSize); });
+}
+
+// Streamed stages are the last and largest, so what it posts is due a long way
+// off - reading from disk can wait behind the resident stages
+ConvolutionStreamWorker::ConvolutionStreamWorker()
+    : ConvolutionWorker("Convolution Stream Worker", juce::Thread::Priority::normal, true)
+{
+}
+
+//==============================================================================
+// StageProcessor - per-instance state for one uniformly partitioned stage
+//==============================================================================
+
+struct PartitionedConvolver::StageProcessor
+{
+    // One partition's worth of work: the input frame going in and the output
+    // partition coming back. A stage on a worker has two, so one can still be
+    // running while the next one is posted.
+    struct Job
+    {
+        std::vector<std::vector<float>> frame;    // [ch] last 2P input samples
+        std::vector<std::vector<float>> result;   // [ch] P output samples
+
+        juce::int64 postedAt       = 0;   // state position it was posted at
+        juce::int64 resultPosition = 0;   // output ring position the result belongs at
+
+        // Partitions the audio thread had to drop since the previous job -
+        // entered into the delay line as silence ahead of this one
+        int skipBefore = 0;
+
+        // The history was cleared since the previous job - the delay line
+        // is zeroed before this one goes in
+        bool clearBefore = false;
+
+        std::atomic<int> status { jobIdle };
+    };
+
+    StageProcessor(const Kernel& k, const Kernel::Stage& st, int numChannels, bool runTrueStereo, bool runAsync)
+        : kernel(k),
+          stage(st),
+          trueStereo(runTrueStereo),
+          async(runAsync),
+          partitionSize(st.partitionSize),
+          spectrumSize(2 * (st.partitionSize + 1)),
+          fft(log2OfPowerOfTwo(2 * st.partitionSize))
+    {
+        for (int j = 0; j < (async ? 2 : 1); ++j)
+        {
+            jobs[j].frame .resize((size_t) numChannels, std::vector<float>((size_t) (2 * partitionSize), 0.0f));
+            jobs[j].result.resize((size_t) numChannels, std::vector<float>((size_t) partitionSize, 0.0f));
+        }
+
+        fdl.resize((size_t) numChannels, std::vector<float>((size_t) (stage.numPartitions * spectrumSize), 0.0f));
+
+        work .resize((size_t) (4 * partitionSize), 0.0f);
+        accum.resize((size_t) spectrumSize, 0.0f);
+    }
+
+    // Only while no worker can be running this stage
+    void clear()
+    {
+        for (auto& job : jobs)
+        {
+            for (auto* v : { &job.frame, &job.result })
+                for (auto& ch : *v)
+                    std::fill(ch.begin(), ch.end(), 0.0f);
+
+            job.skipBefore  = 0;
+            job.clearBefore = false;
+            job.status.store(jobIdle, std::memory_order_relaxed);
+        }
+
+        for (auto& ch : fdl)
+            std::fill(ch.begin(), ch.end(), 0.0f);
+
+        fdlPos             = 0;
+        nextPost           = 0;
+        nextRun            = 0;
+        droppedPartitions  = 0;
+        clearPending       = false;
+    }
+
+    // Audio thread: forgets the input heard so far. The delay line of an
+    // async stage belongs to the worker, which clears it ahead of the next
+    // job posted from here on.
+    void clearHistory() noexcept
+    {
+        if (!async)
+        {
+            clear();
+            return;
+        }
+
+        for (auto& job : jobs)
+            cancel(job);
+
+        droppedPartitions = 0;
+        clearPending      = true;
+    }
+
+    // Audio thread: a job not started yet is dropped, one that is running
+    // finishes unheard, a finished one is thrown away. Never waits - the
+    // worker sets what it holds back to idle itself.
+    static void cancel(Job& job) noexcept
+    {
+        for (int status = job.status.load(std::memory_order_acquire);;)
+        {
+            if (status == jobDone)
+            {
+                job.status.store(jobIdle, std::memory_order_relaxed);
+                return;
+            }
+
+            if (status != jobPending && status != jobRunning)
+                return;
+
+            // Fails only if the worker moved it on meanwhile - look again
+            if (job.status.compare_exchange_strong(status, jobDiscarded, std::memory_order_acq_rel))
+                return;
+        }
+    }
+
+    // Streamed stages, on the stream worker after each job: asks the OS to
+    // read the spectra back ahead of the next job if any of them were
+    // evicted, rather than faulting them in one page at a time then
+    void prefetchSpectra() const noexcept
+    {
+       #if !JUCE_WINDOWS
+        if (stage.mappedSpectra == nullptr)
+            return;
+
+        const auto pageSize = (std::uintptr_t) sysconf(_SC_PAGESIZE);
+        const auto begin    = reinterpret_cast<std::uintptr_t>(stage.mappedSpectra);
+        const auto end      = begin + (std::uintptr_t) kernel.numChannels * (std::uintptr_t) stage.numPartitions
+                                        * (std::uintptr_t) spectrumSize * sizeof(float);
+        const auto aligned  = begin & ~(pageSize - 1);
+
+        madvise(reinterpret_cast<void*>(aligned), (size_t) (end - aligned), MADV_WILLNEED);
+       #endif
+    }
+
+    // Overlap-save over the last 2P input samples held in the job's frame.
+    // Without output only the frame's spectrum is entered into the delay
+    // line, for a job whose result is no longer wanted. Runs on the audio
+    // thread for stages that aren't async, otherwise only on the worker.
+    void compute(Job& job, bool withOutput, const std::function<void()>& runShorterJobs = nullptr)
+    {
+        const int numBins       = partitionSize + 1;
+        const int numPartitions = stage.numPartitions;
+        const int numChannels   = (int) fdl.size();
+
+        if (job.clearBefore)
+        {
+            for (auto& ch : fdl)
+                std::fill(ch.begin(), ch.end(), 0.0f);
+
+            fdlPos = 0;
+            job.clearBefore = false;
+        }
+
+        for (; job.skipBefore > 0; --job.skipBefore)
+        {
+            for (auto& ch : fdl)
+                std::fill_n(ch.data() + fdlPos * spectrumSize, spectrumSize, 0.0f);
+
+            fdlPos = (fdlPos + 1) % numPartitions;
+        }
+
+        // One forward transform per input channel, whatever it feeds
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            std::copy(job.frame[(size_t) ch].begin(), job.frame[(size_t) ch].end(), work.begin());
+            std::fill(work.begin() + 2 * partitionSize, work.end(), 0.0f);
+            fft.performRealOnlyForwardTransform(work.data(), true);
+
+            float* slot = fdl[(size_t) ch].data() + fdlPos * spectrumSize;
+            std::copy(work.begin(), work.begin() + spectrumSize, slot);
+
+            if (runShorterJobs)
+                runShorterJobs();
+        }
+
+        for (int out = 0; out < numChannels && withOutput; ++out)
+        {
+            std::fill(accum.begin(), accum.end(), 0.0f);
+
+            for (int in = 0; in < numChannels; ++in)
+            {
+                const int irChannel = irChannelFor(kernel, trueStereo, in, out);
+
+                if (irChannel < 0)
+                    continue;
+
+                // Streamed spectra page in from the spill file here
+                const float* spectra = stage.getSpectra(irChannel);
+
+                for (int i = 0; i < numPartitions; ++i)
+                {
+                    const int idx = (fdlPos - i + numPartitions) % numPartitions;
+                    complexMultiplyAccumulate(accum.data(),
+                                              fdl[(size_t) in].data() + idx * spectrumSize,
+                                              spectra + i * spectrumSize,
+                                              numBins);
+
+                    if (runShorterJobs && i % kPartitionsBetweenYields == kPartitionsBetweenYields - 1)
+                        runShorterJobs();
+                }
+            }
+
+            std::copy(accum.begin(), accum.end(), work.begin());
+            fft.performRealOnlyInverseTransform(work.data());
+
+            std::copy(work.begin() + partitionSize, work.begin() + 2 * partitionSize, job.result[(size_t) out].begin());
+        }
+
+        fdlPos = (fdlPos + 1) % numPartitions;
+    }
+
+    // Worker: takes the next job in posting order, if it has been posted.
+    // False once there is nothing left to do.
+    bool runNextJob(const std::function<void()>& runShorterJobs)
+    {
+        auto& job  = jobs[nextRun & 1];
+        int status = job.status.load(std::memory_order_acquire);
+
+        if (status == jobPending)
+        {
+            // Lost to the deadline in between - look again
+            if (!job.status.compare_exchange_strong(status, jobRunning, std::memory_order_acq_rel))
+                return true;
+
+            compute(job, true, runShorterJobs);
+
+            // Given up on while it ran - the audio thread has moved on without it
+            int running = jobRunning;
+            if (!job.status.compare_exchange_strong(running, jobDone, std::memory_order_acq_rel))
+                job.status.store(jobIdle, std::memory_order_release);
+        }
+        else if (status == jobLate)
+        {
+            // The partitions after it still need its input
+            compute(job, false, runShorterJobs);
+            job.status.store(jobIdle, std::memory_order_release);
+        }
+        else if (status == jobDiscarded)
+        {
+            job.status.store(jobIdle, std::memory_order_release);
+        }
+        else
+        {
+            return false;
+        }
+
+        ++nextRun;
+        return true;
+    }
+
+    // How often a long job on the worker lets shorter ones through
+    static constexpr int kPartitionsBetweenYields = 8;
+
+    const Kernel&        kernel;
+    const Kernel::Stage& stage;
+    const bool           trueStereo;
+    const bool           async;   // posted to a worker rather than computed in place
+
+    const int partitionSize;
+    const int spectrumSize;
+
+    Job jobs[2];
+
+    // Owned by whoever computes the stage - the worker for async stages
+    juce::dsp::FFT fft;
+    std::vector<std::vector<float>> fdl;   // [ch] frequency-domain delay line
+    std::vector<float> work;
+    std::vector<float> accum;
+    int fdlPos = 0;
+    unsigned int nextRun = 0;    // worker: sequence number of the next job to run
+
+    // Audio thread
+    unsigned int nextPost = 0;   // sequence number of the next job; it goes in jobs[nextPost & 1]
+    int droppedPartitions = 0;   // not posted since the last job, because its slot was still busy
+    bool clearPending = false;   // clearHistory() since the last job
+};
+
+//==============================================================================
+// State - everything one engine needs to run one kernel
+//==============================================================================
+
+struct PartitionedConvolver::State
+{
+    std::shared_ptr<const Kernel> kernel;
+
+    int numChannels = 0;
+    int blockSize   = 0;   // = kernel head size; all partition sizes are multiples
+    int delay       = 0;   // pre-delay - added to every output position
+    bool mid        = false; // mono kernel run once on (L + R) / 2
+    bool trueStereo = false; // four-channel kernel, both inputs reach both outputs
+
+    std::vector<std::vector<float>> headHistory;   // [ch] last (B - 1) inputs + current sub-block
+    std::vector<std::vector<float>> history;       // [ch] input ring for the FFT stages
+    std::vector<std::vector<float>> output;        // [ch] output ring stages accumulate into
+    std::vector<float> scratch;
+
+    int historyMask = 0;
+    int outputMask  = 0;
+
+    juce::int64 position = 0;
+
+    // How this state fades in over the one it replaces
+    Crossfade fadeIn = Crossfade::equalPower;
+
+    std::vector<std::unique_ptr<StageProcessor>> stages;
+
+    void clear()
+    {
+        for (auto* v : { &headHistory, &history, &output })
+            for (auto& ch : *v)
+                std::fill(ch.begin(), ch.end(), 0.0f);
+
+        for (auto& st : stages)
+            st->clear();
+
+        position = 0;
+    }
+
+    // Audio thread - what clear() does, leaving the workers' side to them
+    void clearHistory() noexcept
+    {
+        for (auto* v : { &headHistory, &history, &output })
+            for (auto& ch : *v)
+                std::fill(ch.begin(), ch.end(), 0.0f);
+
+        for (auto& st : stages)
+            st->clearHistory();
+
+        position = 0;
+    }
+};
+
+//==============================================================================
+// PartitionedConvolver
+//==============================================================================
+
+PartitionedConvolver::PartitionedConvolver()
+{
+    worker      ->addEngine(this);
+    streamWorker->addEngine(this);
+}
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+    worker      ->removeEngine(this);
+    streamWorker->removeEngine(this);
+
+    delete activeState .exchange(nullptr);
+    delete pendingState.exchange(nullptr);
+    delete fadingState .exchange(nullptr);
+    delete retiredState.exchange(nullptr);
+}
+
+void PartitionedConvolver::setHeadSize(int newHeadSize)
+{
+    headSize = juce::nextPowerOfTwo(juce::jlimit(kMinHeadSize, kMaxHeadSize, newHeadSize));
+}
+
+void PartitionedConvolver::prepare(const juce::dsp::ProcessSpec& spec)
+{
+    currentSpec = spec;
+    prepared    = true;
+
+    auto fresh = kernel != nullptr ? createState(kernel) : nullptr;
+
+    fadeLength   = juce::jmax(1, juce::roundToInt(spec.sampleRate * kCrossfadeSeconds));
+    fadePosition = 0;
+
+    fadeGain      .resize((size_t) fadeLength + 1);
+    fadeGainLinear.resize((size_t) fadeLength + 1);
+    for (int i = 0; i <= fadeLength; ++i)
+    {
+        fadeGain      [(size_t) i] = std::sin(0.5f * juce::MathConstants<float>::pi * (float) i / (float) fadeLength);
+        fadeGainLinear[(size_t) i] = (float) i / (float) fadeLength;
+    }
+
+    fadeBuffer.setSize(juce::jmax(1, (int) spec.numChannels),
+                       juce::jmax(1, (int) spec.maximumBlockSize));
+
+    // Not processing during prepare, but the workers may still be scanning
+    const juce::ScopedLock sl (worker->getLock());
+    const juce::ScopedLock sl2(streamWorker->getLock());
+
+    delete activeState .exchange(fresh.release());
+    delete pendingState.exchange(nullptr);
+    delete fadingState .exchange(nullptr);
+    delete retiredState.exchange(nullptr);
+}
+
+void PartitionedConvolver::reset()
+{
+    // With both worker locks held no job is running, so the states can be
+    // cleared outright - jobs in flight included
+    const juce::ScopedLock sl (worker->getLock());
+    const juce::ScopedLock sl2(streamWorker->getLock());
+
+    // Drops an unfinished crossfade - the incoming state simply takes over
+    delete fadingState.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (auto* s = activeState.load(std::memory_order_acquire))
+        s->clear();
+}
+
+std::shared_ptr<const PartitionedConvolver::Kernel>
+PartitionedConvolver::createKernel(const juce::AudioBuffer<float>& ir, int requestedHeadSize,
+                                   bool includesPostProcessing, int residentLength)
+{
+    auto k = std::make_shared<Kernel>();
+    k->includesPostProcessing = includesPostProcessing;
+
+    const int B           = juce::nextPowerOfTwo(juce::jlimit(kMinHeadSize, kMaxHeadSize, requestedHeadSize));
+    const int irLength    = ir.getNumSamples();
+    const int numChannels = juce::jmax(1, ir.getNumChannels());
+
+    k->headSize    = B;
+    k->numChannels = numChannels;
+    k->irLength    = irLength;
+    k->trueStereo  = numChannels == kTrueStereoChannels;
+
+    auto irSample = [&](int ch, int n)
+    {
+        return (ch < ir.getNumChannels() && n < irLength) ? ir.getSample(ch, n) : 0.0f;
+    };
+
+    // Direct-form head
+    k->head.resize((size_t) numChannels);
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int n = 0; n < juce::jmin(B, irLength); ++n)
+            k->head[(size_t) ch].push_back(irSample(ch, n));
+
+    // Streamed spectra are written out partition by partition, so building
+    // the kernel never holds them all either
+    std::shared_ptr<SpillFile> spill;
+    std::unique_ptr<juce::FileOutputStream> spillStream;
+    std::vector<juce::int64> spillOffsets;   // per stage, bytes into the file
+
+    if (residentLength >= 0 && residentLength < irLength)
+    {
+        spill = std::make_shared<SpillFile>();
+        spill->file = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                          .getNonexistentChildFile("ADSREchoTail", ".spectra", false);
+        spillStream = spill->file.createOutputStream();
+
+        if (spillStream == nullptr || spillStream->failedToOpen())
+        {
+            DBG("PartitionedConvolver - Could not create spill file, keeping the whole IR in memory");
+            return createKernel(ir, requestedHeadSize, includesPostProcessing);
+        }
+    }
+
+    const int maxPartitionSize = spill != nullptr ? kMaxStreamedPartitionSize : kMaxPartitionSize;
+
+    // FFT stages. Partition size grows 4x per stage; each stage is made long
+    // enough that the next one starts at least three of its partitions in,
+    // which gives the worker a full partition of slack plus one of grace
+    int offset = B;
+    int P      = B;
+
+    while (offset < irLength)
+    {
+        const int nextP          = juce::jmin(P * 4, juce::jmax(maxPartitionSize, B));
+        const int partitionsLeft = divCeil(irLength - offset, P);
+
+        int numPartitions = partitionsLeft;
+        if (nextP > P)
+            numPartitions = juce::jmin(partitionsLeft, juce::jmax(1, divCeil(3 * nextP - offset, P)));
+
+        Kernel::Stage stage;
+        stage.partitionSize = P;
+        stage.offset        = offset;
+        stage.numPartitions = numPartitions;
+        stage.async         = P > B;
+        stage.streamed      = spill != nullptr && stage.async && offset >= residentLength;
+
+        const int spectrumSize = 2 * (P + 1);
+        juce::dsp::FFT fft(log2OfPowerOfTwo(2 * P));
+        std::vector<float> work((size_t) (4 * P));
+
+        spillOffsets.push_back(stage.streamed ? spillStream->getPosition() : -1);
+
+        if (!stage.streamed)
+            stage.spectra.resize((size_t) numChannels);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            if (!stage.streamed)
+                stage.spectra[(size_t) ch].resize((size_t) (numPartitions * spectrumSize));
+
+            for (int i = 0; i < numPartitions; ++i)
+            {
+                std::fill(work.begin(), work.end(), 0.0f);
+
+                const int start = offset + i * P;
+                for (int n = 0; n < P; ++n)
+                    work[(size_t) n] = irSample(ch, start + n);
+
+                fft.performRealOnlyForwardTransform(work.data(), true);
+
+                if (stage.streamed)
+                    spillStream->write(work.data(), sizeof(float) * (size_t) spectrumSize);
+                else
+                    std::copy(work.begin(), work.begin() + spectrumSize,
+                              stage.spectra[(size_t) ch].begin() + i * spectrumSize);
+            }
+        }
+
+        k->stages.push_back(std::move(stage));
+
+        offset += numPartitions * P;
+        P = nextP;
+    }
+
+    if (spill != nullptr)
+    {
+        spillStream->flush();
+        const bool written  = spillStream->getStatus().wasOk();
+        const auto expected = spillStream->getPosition();
+        spillStream.reset();
+
+        if (written)
+            spill->map = std::make_unique<juce::MemoryMappedFile>(spill->file, juce::MemoryMappedFile::readOnly);
+
+        if (!written || spill->map->getData() == nullptr || (juce::int64) spill->map->getSize() < expected)
+        {
+            DBG("PartitionedConvolver - Could not map spill file, keeping the whole IR in memory");
+            return createKernel(ir, requestedHeadSize, includesPostProcessing);
+        }
+
+        const auto* base = static_cast<const char*>(spill->map->getData());
+
+        for (size_t i = 0; i < k->stages.size(); ++i)
+            if (k->stages[i].streamed)
+                k->stages[i].mappedSpectra = reinterpret_cast<const float*>(base + spillOffsets[i]);
+
+        k->spill = std::move(spill);
+    }
+
+    return k;
+}
+
+void PartitionedConvolver::loadImpulseResponse(const juce::AudioBuffer<float>& ir)
+{
+    setKernel(createKernel(ir, headSize));
+}
+
+void PartitionedConvolver::setPreDelay(int numSamples)
+{
+    numSamples = juce::jmax(0, numSamples);
+
+    if (numSamples == preDelay)
+        return;
+
+    preDelay = numSamples;
+    setKernel(kernel);
+}
+
+void PartitionedConvolver::setMidInput(bool shouldUseMid)
+{
+    if (shouldUseMid == midInput)
+        return;
+
+    midInput = shouldUseMid;
+    setKernel(kernel);
+}
+
+void PartitionedConvolver::clearHistory()
+{
+    jassert(!isCrossfading());
+
+    if (auto* s = activeState.load(std::memory_order_relaxed))
+        s->clearHistory();
+}
+
+void PartitionedConvolver::setKernel(std::shared_ptr<const Kernel> newKernel, Crossfade curve)
+{
+    kernel = std::move(newKernel);
+
+    freeRetiredState();
+
+    if (!prepared || kernel == nullptr)
+        return;
+
+    auto fresh = createState(kernel);
+    fresh->fadeIn = curve;
+
+    // A pending state has never been active, so the worker cannot be using it
+    delete pendingState.exchange(fresh.release(), std::memory_order_acq_rel);
+}
+
+std::unique_ptr<PartitionedConvolver::State>
+PartitionedConvolver::createState(std::shared_ptr<const Kernel> forKernel) const
+{
+    auto s = std::make_unique<State>();
+
+    // Mid input runs a single channel of history and stages
+    s->mid = midInput && forKernel->numChannels == 1 && currentSpec.numChannels > 1;
+
+    // True stereo needs two channels to cross; a mono host hears L->L only
+    s->trueStereo = forKernel->trueStereo && currentSpec.numChannels > 1;
+
+    const int numChannels = s->mid ? 1 : s->trueStereo ? 2 : juce::jmax(1, (int) currentSpec.numChannels);
+    const int B           = forKernel->headSize;
+
+    int maxPartition = B;
+    int maxReach     = B;
+    for (const auto& st : forKernel->stages)
+    {
+        maxPartition = juce::jmax(maxPartition, st.partitionSize);
+        maxReach     = juce::jmax(maxReach, st.offset + st.partitionSize);
+    }
+
+    // Results land up to preDelay + maxReach ahead of the read position
+    const int historySize = juce::nextPowerOfTwo(2 * maxPartition);
+    const int outputSize  = juce::nextPowerOfTwo(maxReach + B + preDelay);
+
+    s->kernel      = forKernel;
+    s->numChannels = numChannels;
+    s->blockSize   = B;
+    s->delay       = preDelay;
+    s->historyMask = historySize - 1;
+    s->outputMask  = outputSize - 1;
+
+    s->headHistory.resize((size_t) numChannels, std::vector<float>((size_t) (2 * B), 0.0f));
+    s->history    .resize((size_t) numChannels, std::vector<float>((size_t) historySize, 0.0f));
+    s->output     .resize((size_t) numChannels, std::vector<float>((size_t) outputSize, 0.0f));
+    s->scratch    .resize((size_t) B, 0.0f);
+
+    // Streamed stages always go to the stream worker - paging in their
+    // spectra is not for the audio thread
+    const int minWorkerPartition = (int) std::ceil(kMinWorkerPartitionSeconds * currentSpec.sampleRate);
+
+    for (const auto& st : forKernel->stages)
+    {
+        const bool async = st.streamed || (st.async && st.partitionSize >= minWorkerPartition);
+        s->stages.push_back(std::make_unique<StageProcessor>(*forKernel, st, numChannels, s->trueStereo, async));
+    }
+
+    return s;
+}
+
+// Cancels whatever the state has posted to the workers, without waiting for
+// a job that is already running. That one finishes unheard; the state is
+// only freed with both worker locks held, when no job can be running.
+void PartitionedConvolver::cancelJobs(State& s)
+{
+    for (auto& st : s.stages)
+        for (auto& job : st->jobs)
+            StageProcessor::cancel(job);
+}
+
+void PartitionedConvolver::swapInPendingState()
+{
+    if (pendingState.load(std::memory_order_relaxed) == nullptr)
+        return;
+
+    // Only one state can be fading out or waiting to be freed - if the last
+    // one hasn't been collected yet, keep running the current state and try
+    // again next block
+    if (retiredState.load(std::memory_order_acquire) != nullptr
+        || fadingState.load(std::memory_order_relaxed) != nullptr)
+        return;
+
+    auto* incoming = pendingState.exchange(nullptr, std::memory_order_acq_rel);
+    if (incoming == nullptr)
+        return;
+
+    auto* outgoing = activeState.load(std::memory_order_relaxed);
+
+    activeState.store(incoming, std::memory_order_release);
+
+    if (outgoing == nullptr)
+        return;
+
+    if (fadeLength > 0)
+    {
+        // Keeps running (and ringing out) until the crossfade completes
+        fadePosition = 0;
+        fadingState.store(outgoing, std::memory_order_release);
+    }
+    else
+    {
+        cancelJobs(*outgoing);
+        retiredState.store(outgoing, std::memory_order_release);
+        worker->requestRun();
+    }
+}
+
+void PartitionedConvolver::freeRetiredState()
+{
+    if (retiredState.load(std::memory_order_acquire) == nullptr)
+        return;
+
+    const juce::ScopedLock sl (worker->getLock());
+    const juce::ScopedLock sl2(streamWorker->getLock());
+    delete retiredState.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void PartitionedConvolver::collectRetiredState()
+{
+    // Called by the resident worker, which already holds its own lock. The
+    // stream worker may be paging in spectra for a while - rather than wait
+    // behind the disk, leave the state for the next wake
+    if (retiredState.load(std::memory_order_acquire) == nullptr)
+        return;
+
+    const juce::ScopedTryLock sl(streamWorker->getLock());
+    if (!sl.isLocked())
+    {
+        worker->requestRun();
+        return;
+    }
+
+    delete retiredState.exchange(nullptr, std::memory_order_acq_rel);
+}
+
+void PartitionedConvolver::process(const juce::dsp::ProcessContextReplacing<float>& context,
+                                   PostProcessor* post)
+{
+    swapInPendingState();
+
+    auto* s = activeState.load(std::memory_order_relaxed);
+    if (s == nullptr || context.isBypassed)
+        return;
+
+    auto& block = context.getOutputBlock();
+
+    const bool postNew = post != nullptr && !s->kernel->includesPostProcessing;
+
+    // Post-processing picking up after blocks without it starts clean rather
+    // than from whatever it last ran on
+    auto startPostProcessing = [this, post](bool runs)
+    {
+        if (runs && !postProcessing)
+            post->resetPostProcessing();
+
+        postProcessing = runs;
+    };
+
+    auto* old = fadingState.load(std::memory_order_relaxed);
+    if (old == nullptr)
+    {
+        processState(*s, block);
+        startPostProcessing(postNew);
+
+        if (postNew)
+            post->postProcess(block);
+        return;
+    }
+
+    const bool postOld = post != nullptr && !old->kernel->includesPostProcessing;
+    startPostProcessing(postOld || postNew);
+
+    // Crossfade: the outgoing state runs on a copy of the input, the incoming
+    // one in place, then the two are mixed
+    const int numSamples  = (int) block.getNumSamples();
+    const int numChannels = juce::jmin((int) block.getNumChannels(), fadeBuffer.getNumChannels());
+
+    for (int start = 0; start < numSamples;)
+    {
+        const int n = juce::jmin(numSamples - start, fadeBuffer.getNumSamples());
+
+        auto sub = block.getSubBlock((size_t) start, (size_t) n);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            juce::FloatVectorOperations::copy(fadeBuffer.getWritePointer(ch),
+                                              sub.getChannelPointer((size_t) ch), n);
+
+        juce::dsp::AudioBlock<float> oldBlock(fadeBuffer.getArrayOfWritePointers(),
+                                              (size_t) numChannels, (size_t) n);
+
+        processState(*old, oldBlock);
+        processState(*s, sub);
+
+        // Post-processing is stateful, so it runs on one stream only: on the
+        // mix when both need it, otherwise on whichever side lacks it
+        if (postOld != postNew)
+        {
+            if (postOld)
+                post->postProcess(oldBlock);
+            else
+                post->postProcess(sub);
+        }
+
+        // A changed pre-delay makes even the same IR uncorrelated
+        const bool equalGain = s->fadeIn == Crossfade::equalGain && s->delay == old->delay;
+        const auto& gain     = equalGain ? fadeGainLinear : fadeGain;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* y       = sub.getChannelPointer((size_t) ch);
+            const float* o = fadeBuffer.getReadPointer(ch);
+
+            for (int i = 0; i < n; ++i)
+            {
+                const int f = juce::jmin(fadePosition + i, fadeLength);
+                y[i] = y[i] * gain[(size_t) f] + o[i] * gain[(size_t) (fadeLength - f)];
+            }
+        }
+
+        if (postOld && postNew)
+            post->postProcess(sub);
+
+        fadePosition += n;
+        start        += n;
+
+        if (fadePosition >= fadeLength)
+        {
+            cancelJobs(*old);
+            fadingState .store(nullptr, std::memory_order_release);
+            retiredState.store(old,     std::memory_order_release);
+
+            // Collected off the audio thread; anything queued behind it swaps
+            // in once it's gone
+            worker->requestRun();
+
+            startPostProcessing(postNew);
+
+            if (start < numSamples)
+            {
+                auto rest = block.getSubBlock((size_t) start, (size_t) (numSamples - start));
+                processState(*s, rest);
+
+                if (postNew)
+                    post->postProcess(rest);
+            }
+
+            return;
+        }
+    }
+}
+
+void PartitionedConvolver::processState(State& s, juce::dsp::AudioBlock<float>& block)
+{
+    const auto& k          = *s.kernel;
+    const int B            = s.blockSize;
+    const int numSamples   = (int) block.getNumSamples();
+    const int numChannels  = juce::jmin((int) block.getNumChannels(), s.numChannels);
+
+    const bool mid = s.mid && block.getNumChannels() > 1;
+
+    if (mid)
+    {
+        float* l = block.getChannelPointer(0);
+        juce::FloatVectorOperations::add(l, block.getChannelPointer(1), numSamples);
+        juce::FloatVectorOperations::multiply(l, 0.5f, numSamples);
+    }
+
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        // Sub-blocks never cross a multiple of B, which is where stages fire
+        const int toBoundary = B - (int) (s.position % B);
+        const int n          = juce::jmin(toBoundary, numSamples - done);
+
+        // Every input is taken in before any output is written - with true
+        // stereo each output hears both
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float* in = block.getChannelPointer((size_t) ch) + done;
+
+            auto& history = s.history[(size_t) ch];
+            for (int i = 0; i < n; ++i)
+                history[(size_t) ((s.position + i) & s.historyMask)] = in[i];
+
+            std::copy(in, in + n, s.headHistory[(size_t) ch].data() + (B - 1));
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* io = block.getChannelPointer((size_t) ch) + done;
+            float* y  = s.scratch.data();
+
+            juce::FloatVectorOperations::clear(y, n);
+
+            // Direct-form head: y[i] += h[j] * x[i - j], one vector op per tap
+            for (int in = 0; in < numChannels; ++in)
+            {
+                const int irChannel = irChannelFor(k, s.trueStereo, in, ch);
+
+                if (irChannel < 0)
+                    continue;
+
+                const auto& hh   = s.headHistory[(size_t) in];
+                const auto& head = k.head[(size_t) irChannel];
+
+                for (size_t j = 0; j < head.size(); ++j)
+                    if (head[j] != 0.0f)
+                        juce::FloatVectorOperations::addWithMultiply(y, hh.data() + (B - 1) - j, head[j], n);
+            }
+
+            auto& out = s.output[(size_t) ch];
+
+            if (s.delay == 0)
+            {
+                // Everything the FFT stages have already placed here
+                for (int i = 0; i < n; ++i)
+                {
+                    auto& slot = out[(size_t) ((s.position + i) & s.outputMask)];
+                    y[i] += slot;
+                    slot  = 0.0f;
+                }
+
+                std::copy(y, y + n, io);
+            }
+            else
+            {
+                // Pre-delayed: the head is due later like everything else, and
+                // what is due now is already complete in the ring
+                for (int i = 0; i < n; ++i)
+                    out[(size_t) ((s.position + s.delay + i) & s.outputMask)] += y[i];
+
+                for (int i = 0; i < n; ++i)
+                {
+                    auto& slot = out[(size_t) ((s.position + i) & s.outputMask)];
+                    io[i] = slot;
+                    slot  = 0.0f;
+                }
+            }
+        }
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto& hh = s.headHistory[(size_t) ch];
+            std::copy(hh.data() + n, hh.data() + n + (B - 1), hh.data());
+        }
+
+        s.position += n;
+        done       += n;
+
+        if (s.position % B == 0)
+            runStages(s);
+    }
+
+    if (mid)
+        for (size_t ch = 1; ch < block.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::copy(block.getChannelPointer(ch), block.getChannelPointer(0), numSamples);
+}
+
+void PartitionedConvolver::runStages(State& s)
+{
+    const auto now            = s.position;
+    const bool waitForWorkers = nonRealtime.load(std::memory_order_relaxed);
+    bool posted               = false;
+    bool postedStreamed       = false;
+
+    for (auto& stPtr : s.stages)
+    {
+        auto& st     = *stPtr;
+        const int P  = st.partitionSize;
+
+        if (now % P != 0)
+            continue;
+
+        auto addResult = [&s](const StageProcessor::Job& job, int partitionSize)
+        {
+            for (size_t ch = 0; ch < job.result.size(); ++ch)
+            {
+                auto& out = s.output[ch];
+                for (int i = 0; i < partitionSize; ++i)
+                    out[(size_t) ((job.resultPosition + i) & s.outputMask)] += job.result[ch][(size_t) i];
+            }
+        };
+
+        auto fillFrame = [&s, now, P](StageProcessor::Job& job)
+        {
+            for (size_t ch = 0; ch < job.frame.size(); ++ch)
+            {
+                auto& history = s.history[ch];
+                auto& frame   = job.frame[ch];
+
+                for (int i = 0; i < 2 * P; ++i)
+                    frame[(size_t) i] = history[(size_t) ((now - 2 * P + i) & s.historyMask)];
+            }
+        };
+
+        if (!st.async)
+        {
+            auto& job = st.jobs[0];
+            fillFrame(job);
+            job.resultPosition = now - P + st.stage.offset + s.delay;
+
+            st.compute(job, true);
+            addResult(job, P);
+            continue;
+        }
+
+        auto& stageWorker = st.stage.streamed ? *streamWorker : *worker;
+
+        // Whatever the worker has finished goes in. A job's output starts
+        // being read two partitions after it was posted - past that it is
+        // given up on rather than waited for. One the worker hasn't started
+        // still has its input entered into the delay line; one that is
+        // running finishes for the same reason, unheard.
+        for (auto& job : st.jobs)
+        {
+            const bool due = now - job.postedAt >= 2 * P;
+
+            // Rendering offline, where waiting costs nothing but time
+            if (due && waitForWorkers)
+            {
+                for (int status = job.status.load(std::memory_order_acquire);
+                     status == jobPending || status == jobRunning;
+                     status = job.status.load(std::memory_order_acquire))
+                {
+                    stageWorker.wake();
+                    std::this_thread::yield();
+                }
+            }
+
+            for (int status = job.status.load(std::memory_order_acquire);;)
+            {
+                if (status == jobDone)
+                {
+                    addResult(job, P);
+                    job.status.store(jobIdle, std::memory_order_relaxed);
+                    break;
+                }
+
+                if (!due || (status != jobPending && status != jobRunning))
+                    break;
+
+                // Fails only if the worker moved it on meanwhile - look again
+                if (job.status.compare_exchange_strong(status, status == jobPending ? jobLate : jobDiscarded,
+                                                       std::memory_order_acq_rel))
+                {
+                    underruns.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+
+        auto& job = st.jobs[st.nextPost & 1];
+
+        // Only after clearHistory() when rendering offline - a cancelled job
+        // still waiting to be set back to idle
+        if (waitForWorkers)
+        {
+            while (job.status.load(std::memory_order_acquire) != jobIdle)
+            {
+                stageWorker.wake();
+                std::this_thread::yield();
+            }
+        }
+
+        // Still with the worker - this partition's input is lost, and goes
+        // into the delay line as silence ahead of the next job
+        if (job.status.load(std::memory_order_acquire) != jobIdle)
+        {
+            ++st.droppedPartitions;
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        fillFrame(job);
+        job.postedAt       = now;
+        job.resultPosition = now - P + st.stage.offset + s.delay;
+        job.skipBefore     = st.droppedPartitions;
+        job.clearBefore    = st.clearPending;
+        st.droppedPartitions = 0;
+        st.clearPending      = false;
+
+        job.status.store(jobPending, std::memory_order_release);
+        ++st.nextPost;
+
+        (st.stage.streamed ? postedStreamed : posted) = true;
+    }
+
+    if (posted)
+        worker->requestRun();
+
+    if (postedStreamed)
+        streamWorker->requestRun();
+}
+
+void PartitionedConvolver::runPendingJobs(bool streamedStages, int belowPartitionSize,
+                                          const std::function<void(int)>& runShorterJobs)
+{
+    // Called by a worker with its lock held, which keeps both states alive.
+    // Each worker only takes its own kind of stage, and runs a stage's jobs in
+    // the order they were posted.
+    for (auto* s : { activeState.load(std::memory_order_acquire),
+                     fadingState.load(std::memory_order_acquire) })
+    {
+        if (s == nullptr)
+            continue;
+
+        for (auto& st : s->stages)
+        {
+            if (!st->async || st->stage.streamed != streamedStages || st->partitionSize >= belowPartitionSize)
+                continue;
+
+            const int P = st->partitionSize;
+            const std::function<void()> yield = [&runShorterJobs, P] { runShorterJobs(P); };
+
+            bool ran = false;
+            while (st->runNextJob(yield))
+                ran = true;
+
+            if (ran && streamedStages)
+                st->prefetchSpectra();
+        }
+    }
+}
+
+//==============================================================================
+// KernelCache
+//==============================================================================
+
+KernelCache::KernelPtr KernelCache::getOrCreate(const std::shared_ptr<const void>& source,
+                                                int headSize,
+                                                int irLength,
+                                                Variant variant,
+                                                const std::function<KernelPtr()>& create)
+{
+    const int B = juce::nextPowerOfTwo(juce::jlimit(PartitionedConvolver::kMinHeadSize,
+                                                    PartitionedConvolver::kMaxHeadSize,
+                                                    headSize));
+
+    // Held while building so two loaders asking for the same kernel don't
+    // both pay for the FFTs
+    const juce::ScopedLock sl(lock);
+
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const Entry& e) { return e.kernel.expired(); }),
+                  entries.end());
+
+    if (source != nullptr)
+    {
+        for (const auto& e : entries)
+        {
+            const bool sameSource = !e.source.owner_before(source) && !source.owner_before(e.source);
+
+            if (sameSource && e.headSize == B && e.irLength == irLength && e.variant == variant
+                && !e.source.expired())
+                if (auto existing = e.kernel.lock())
+                    return existing;
+        }
+    }
+
+    auto created = create();
+
+    if (created != nullptr && source != nullptr)
+        entries.push_back({ source, B, irLength, variant, created });
+
+    return created;
+}
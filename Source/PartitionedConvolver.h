@@ -0,0 +1,353 @@
+// PartitionedConvolver.h - Zero-latency, non-uniformly partitioned convolution engine
+//
+// The IR is split into a short direct-form head followed by uniformly
+// partitioned FFT stages whose partition size grows along the tail:
+//
+//   [ head : direct FIR, B taps ][ stage 1 : N1 x B ][ stage 2 : N2 x 4B ][ ... ]
+//
+// The head and the short FFT stages run on the audio thread. Longer stages are
+// posted to the shared ConvolutionWorker, and every stage starts at least three
+// of its own partitions into the IR: once its input block is complete the result
+// is not due for another two partitions. Each stage has two job slots, so a job
+// the worker finishes a partition late is still used while the next one is
+// already posted. The audio thread never computes a posted job or waits for one
+// (unless rendering offline) - a job past its deadline is dropped and counted as
+// an underrun, and the engine reports no latency.
+//
+// A four-channel IR is true stereo - L->L, L->R, R->L, R->R. Each input
+// channel is still transformed once per partition; only the spectral
+// multiply-accumulate runs per channel pair, so it costs far less than two
+// stereo convolutions.
+//
+// Very long IRs don't have to be held in memory: stages past a resident length
+// keep their spectra in a memory-mapped spill file and run on a second worker,
+// which pages them in a full (large) partition ahead of when they are due.
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_dsp/juce_dsp.h>
+#endif
+
+#include <functional>
+
+class PartitionedConvolver;
+
+// One background thread shared by every PartitionedConvolver in the process
+// (held through juce::SharedResourcePointer). The audio thread posts tail stages
+// and raises a run flag; the worker scans the registered engines and runs what
+// is pending.
+class ConvolutionWorker : private juce::Thread
+{
+public:
+    ConvolutionWorker();
+    ~ConvolutionWorker() override;
+
+    void addEngine(PartitionedConvolver* engine);
+    void removeEngine(PartitionedConvolver* engine);
+
+    // Realtime safe: raises a flag the worker polls every millisecond, so the
+    // audio thread never touches the thread's event (which takes a lock)
+    void requestRun() noexcept { runRequested.store(true, std::memory_order_release); }
+
+    // Wakes the worker straight away. Blocks briefly - not from a realtime thread.
+    void wake() { requestRun(); notify(); }
+
+    // Held by the worker while it touches engine state - anything that frees
+    // state either worker may be looking at takes both locks first
+    juce::CriticalSection& getLock() { return lock; }
+
+protected:
+    // Runs only the stages streamed from a spill file, or only the others
+    ConvolutionWorker(const juce::String& threadName, juce::Thread::Priority priority,
+                      bool runsStreamedStages);
+
+private:
+    void run() override;
+
+    // Runs what is pending on every engine, in stages with shorter partitions
+    // than belowPartitionSize. With the lock held.
+    void runJobs(int belowPartitionSize);
+
+    const bool streamedStages;
+
+    std::atomic<bool> runRequested { false };
+
+    juce::CriticalSection lock;
+    juce::Array<PartitionedConvolver*> engines;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionWorker)
+};
+
+// Worker for the streamed stages, so paging their spectra in from disk never
+// holds up the resident tail stages. Shared process-wide like ConvolutionWorker.
+class ConvolutionStreamWorker : public ConvolutionWorker
+{
+public:
+    ConvolutionStreamWorker();
+};
+
+class PartitionedConvolver
+{
+public:
+    // Frequency-domain partition set for one IR and one partition schedule.
+    // Immutable once built, so it can be shared between engines.
+    struct Kernel
+    {
+        struct Stage
+        {
+            int  partitionSize = 0;
+            int  offset        = 0;     // first IR sample covered by this stage
+            int  numPartitions = 0;
+            bool async         = false; // may be computed on a worker thread
+            bool streamed      = false; // spectra in the spill file, computed on the stream worker
+
+            // Resident: [irChannel][partition * spectrumSize + n], spectrumSize = 2 * (partitionSize + 1)
+            std::vector<std::vector<float>> spectra;
+
+            // Streamed: the same layout, channels back to back in the mapping
+            const float* mappedSpectra = nullptr;
+
+            const float* getSpectra(int irChannel) const
+            {
+                if (mappedSpectra != nullptr)
+                    return mappedSpectra + (size_t) irChannel * (size_t) numPartitions * (size_t) (2 * (partitionSize + 1));
+
+                return spectra[(size_t) irChannel].data();
+            }
+        };
+
+        int headSize    = 0;
+        int numChannels = 0;
+        int irLength    = 0;
+
+        // numChannels == kTrueStereoChannels: IR channels are LL, LR, RL, RR
+        // (input -> output) rather than one per output channel
+        bool trueStereo = false;
+
+        // The owner's post-processing (see PostProcessor) was applied to the
+        // IR before partitioning, so it is skipped for this kernel's output
+        bool includesPostProcessing = false;
+
+        std::vector<std::vector<float>> head;   // [irChannel][tap], at most headSize taps
+        std::vector<Stage> stages;
+
+        // Keeps the mapped spill file of the streamed stages alive (and
+        // deletes it with the last reference)
+        std::shared_ptr<const void> spill;
+    };
+
+    // Linear processing the owner runs on the wet output (filters, gain). The
+    // engine applies it per kernel so a crossfade between a kernel with it
+    // baked in and one without stays exact. Called on the audio thread.
+    struct PostProcessor
+    {
+        virtual ~PostProcessor() = default;
+        virtual void postProcess(juce::dsp::AudioBlock<float>& block) = 0;
+
+        // Called before postProcess() picks up again after blocks that
+        // didn't need it (a kernel with it baked in), whose state is stale
+        virtual void resetPostProcessing() {}
+    };
+
+    static constexpr int kDefaultHeadSize  = 128;
+    static constexpr int kMinHeadSize      = 16;
+    static constexpr int kMaxHeadSize      = 1024;
+    static constexpr int kMaxPartitionSize = 8192;
+    static constexpr int kTrueStereoChannels = 4;
+
+    // Streamed stages grow further - each partition's spectrum is paged in
+    // once per partition period, so bigger partitions mean less disk traffic
+    // and more time to read it
+    static constexpr int kMaxStreamedPartitionSize = 65536;
+
+    // Stages whose partitions are shorter than this run on the audio thread even
+    // when the kernel allows a worker - their deadline would be too close to
+    // the worker's polling interval
+    static constexpr double kMinWorkerPartitionSeconds = 0.002;
+
+    // Length of the crossfade when a new kernel replaces a running one
+    static constexpr double kCrossfadeSeconds = 0.05;
+
+    // Equal power suits two different IRs, whose outputs are uncorrelated.
+    // Two versions of the same IR (cut shorter, filtered, re-partitioned)
+    // produce nearly the same output and would bump by 3 dB mid-fade, so they
+    // fade at equal gain.
+    enum class Crossfade { equalPower, equalGain };
+
+    PartitionedConvolver();
+    ~PartitionedConvolver();
+
+    // Length of the direct-form head, rounded to a power of two. Smaller heads
+    // cost less per sample but run more FFT stages. Takes effect on the next
+    // kernel, so set it before loading an IR.
+    void setHeadSize(int newHeadSize);
+    int  getHeadSize() const { return headSize; }
+
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset();
+
+    // Not realtime safe - call from the message or a loader thread.
+    // Stages starting past residentLength samples (-1 = keep everything in
+    // memory) are streamed: their spectra are written to a temporary file and
+    // memory-mapped. Falls back to resident stages if the file can't be made.
+    static std::shared_ptr<const Kernel> createKernel(const juce::AudioBuffer<float>& ir, int headSize,
+                                                      bool includesPostProcessing = false,
+                                                      int residentLength = -1);
+
+    // Safe to call while the audio thread is processing. The new kernel is
+    // picked up at the start of a block and crossfaded in over
+    // kCrossfadeSeconds while the old one rings out.
+    void loadImpulseResponse(const juce::AudioBuffer<float>& ir);
+    void setKernel(std::shared_ptr<const Kernel> newKernel, Crossfade curve = Crossfade::equalPower);
+
+    // Delays the wet output by shifting the whole partition schedule: every
+    // stage writes its result that much further ahead in the output ring, so
+    // the delay costs no extra work and only its own length in memory. Takes
+    // effect like a new kernel (crossfaded in). Not realtime safe.
+    void setPreDelay(int numSamples);
+    int  getPreDelay() const { return preDelay; }
+
+    // With a mono kernel, convolve the mid signal (L + R) / 2 once and send
+    // the result to every output channel, instead of convolving each channel
+    // with the shared spectra. No effect on stereo kernels. Takes effect like
+    // a new kernel. Not realtime safe.
+    void setMidInput(bool shouldUseMid);
+    bool getMidInput() const { return midInput; }
+
+    // post, if given, runs on the output of every kernel that does not
+    // already include it
+    void process(const juce::dsp::ProcessContextReplacing<float>& context,
+                 PostProcessor* post = nullptr);
+
+    // True while an old kernel is still fading out
+    bool isCrossfading() const { return fadingState.load(std::memory_order_relaxed) != nullptr; }
+
+    // True while a kernel handed in has not been picked up by process() yet
+    bool isKernelPending() const { return pendingState.load(std::memory_order_relaxed) != nullptr; }
+
+    // Realtime safe, unlike reset(): forgets all input heard so far, for an
+    // owner that stopped calling process() for a while. Jobs still with a
+    // worker are cancelled rather than waited for. Only while
+    // isCrossfading() is false.
+    void clearHistory();
+
+    // Rendering offline: the audio thread waits for a worker that is behind
+    // instead of dropping its partition. Any thread.
+    void setNonRealtime(bool isNonRealtime) { nonRealtime.store(isNonRealtime, std::memory_order_relaxed); }
+
+    // Partitions dropped because a worker missed their deadline, since
+    // construction. Any thread.
+    int getUnderruns() const { return underruns.load(std::memory_order_relaxed); }
+
+private:
+    friend class ConvolutionWorker;
+
+    struct StageProcessor;
+    struct State;
+
+    std::unique_ptr<State> createState(std::shared_ptr<const Kernel> forKernel) const;
+
+    void swapInPendingState();
+    void freeRetiredState();
+    void collectRetiredState();
+    void processState(State& s, juce::dsp::AudioBlock<float>& block);
+    void runStages(State& s);
+    void runPendingJobs(bool streamedStages, int belowPartitionSize,
+                        const std::function<void(int)>& runShorterJobs);
+
+    static void cancelJobs(State& s);
+
+    juce::SharedResourcePointer<ConvolutionWorker>       worker;
+    juce::SharedResourcePointer<ConvolutionStreamWorker> streamWorker;
+
+    int  headSize = kDefaultHeadSize;
+    int  preDelay = 0;
+    bool midInput = false;
+    bool prepared = false;
+    juce::dsp::ProcessSpec currentSpec {};
+
+    // Last kernel handed in from outside - prepare() rebuilds state from it
+    std::shared_ptr<const Kernel> kernel;
+
+    // Audio thread owns activeState; new state arrives through pendingState,
+    // the replaced one keeps running as fadingState for the crossfade and is
+    // then parked in retiredState until the resident worker (or setKernel)
+    // frees it - a second pending state waits for that before swapping in
+    std::atomic<State*> activeState  { nullptr };
+    std::atomic<State*> pendingState { nullptr };
+    std::atomic<State*> fadingState  { nullptr };
+    std::atomic<State*> retiredState { nullptr };
+
+    std::atomic<int>  underruns   { 0 };
+    std::atomic<bool> nonRealtime { false };
+
+    // Audio thread - the owner's post-processing ran last block
+    bool postProcessing = false;
+
+    // Crossfade, audio thread only (allocated in prepare)
+    int fadePosition = 0;
+    int fadeLength   = 0;
+    std::vector<float> fadeGain;          // sin ramp, fadeLength + 1 points
+    std::vector<float> fadeGainLinear;    // straight ramp, fadeLength + 1 points
+    juce::AudioBuffer<float> fadeBuffer;  // outgoing state's output
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
+
+// Process-wide table of kernels, keyed by the IR data they were built from, the
+// head size, the length the IR was cut to and any processing baked into it
+// (held through juce::SharedResourcePointer). Only weak
+// references are kept, so a kernel lives exactly as long as some engine uses it,
+// and every engine running the same IR and scheme shares one set of spectra.
+class KernelCache
+{
+public:
+    using KernelPtr = std::shared_ptr<const PartitionedConvolver::Kernel>;
+
+    // Tone baked into a kernel, quantised so that settings too close to hear
+    // apart share one - cutoffs to 0.01 Hz, gain to 1e-6. All zero = as-is.
+    struct Variant
+    {
+        int lowCut  = 0;
+        int highCut = 0;
+        int gain    = 0;
+
+        static Variant tone(float lowCutHz, float highCutHz, float linearGain)
+        {
+            return { juce::roundToInt(lowCutHz * 100.0f), juce::roundToInt(highCutHz * 100.0f),
+                     juce::roundToInt(linearGain * 1.0e6f) };
+        }
+
+        bool operator== (const Variant& other) const
+        {
+            return lowCut == other.lowCut && highCut == other.highCut && gain == other.gain;
+        }
+    };
+
+    // Returns the live kernel for (source, headSize, irLength, variant), or
+    // stores and returns what create() builds. source must be immutable and
+    // owned by a shared_ptr - its identity is the key. variant tells apart
+    // kernels processed differently from the same IR. Not realtime safe.
+    KernelPtr getOrCreate(const std::shared_ptr<const void>& source,
+                          int headSize,
+                          int irLength,
+                          Variant variant,
+                          const std::function<KernelPtr()>& create);
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<const void> source;
+        int headSize = 0;
+        int irLength = 0;
+        Variant variant;
+        std::weak_ptr<const PartitionedConvolver::Kernel> kernel;
+    };
+
+    juce::CriticalSection lock;
+    std::vector<Entry> entries;
+};
@@ -24,6 +24,8 @@ ADSREchoAudioProcessor::ADSREchoAudioProcessor()
 #endif
 {
     irBank = std::make_shared<IRBank>();
+    irBank->addListener(this);
+    irBank->startDiscovery();
 
     slots.resize(NUM_CHAINS);
     for (int j = 0; j < NUM_CHAINS; j++)
@@ -39,6 +41,13 @@ ADSREchoAudioProcessor::ADSREchoAudioProcessor()
 
 ADSREchoAudioProcessor::~ADSREchoAudioProcessor()
 {
+    cancelPendingUpdate();
+    irBank->removeListener(this);
+}
+
+void ADSREchoAudioProcessor::irListChanged()
+{
+    uiNeedsRebuild.store(true, std::memory_order_release);
 }
 
 //==============================================================================
@@ -116,10 +125,12 @@ void ADSREchoAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     // Pre-allocate dry buffer to avoid allocation in processBlock
     masterDryBuffer.setSize(spec.numChannels, samplesPerBlock);
     chainTempBuffer.setSize(spec.numChannels, samplesPerBlock);
+    alignedDryBuffer.setSize(spec.numChannels, samplesPerBlock);
 
     // CRITICAL: Clear buffers to prevent garbage data
     masterDryBuffer.clear();
     chainTempBuffer.clear();
+    alignedDryBuffer.clear();
 
     for (auto& chain : slots)
     {
@@ -127,6 +138,106 @@ void ADSREchoAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
             slot->prepare(spec);
     }
 
+    // Worst case: a full chain of compressors at maximum lookahead
+    maxLatencySamples = MAX_SLOTS * (int) std::ceil(BasicCompressor::kMaxLookaheadMs * 0.001 * sampleRate);
+
+    dryCompensation.prepare(spec, maxLatencySamples);
+
+    for (auto& compensation : chainCompensation)
+        compensation.prepare(spec, maxLatencySamples);
+
+    // Report the latency up front - modules pick their lookahead up in prepare()
+    const bool parallelEnabled = apvts.getRawParameterValue("parallelEnabled")->load() > 0.5f;
+    currentLatencySamples = 0;
+
+    for (int chainIndex = 0; chainIndex < NUM_CHAINS - !parallelEnabled; chainIndex++)
+        currentLatencySamples = juce::jmax(currentLatencySamples, getChainLatency(chainIndex));
+
+    latencyToReport.store(currentLatencySamples);
+    setLatencySamples(currentLatencySamples);
+}
+
+int ADSREchoAudioProcessor::getChainLatency(int chainIndex) const
+{
+    int latency = 0;
+
+    for (const auto& slot : slots[chainIndex])
+        latency += slot->getLatencySamples();
+
+    return juce::jlimit(0, maxLatencySamples, latency);
+}
+
+void ADSREchoAudioProcessor::handleAsyncUpdate()
+{
+    setLatencySamples(latencyToReport.load());
+}
+
+void ADSREchoAudioProcessor::Compensation::prepare(const juce::dsp::ProcessSpec& spec, int maxDelay)
+{
+    line.setMaximumDelayInSamples(maxDelay);
+    line.prepare(spec);
+
+    fadeLength = juce::jmax(1, (int) std::round(BasicCompressor::kLookaheadFadeMs * 0.001 * spec.sampleRate));
+    fadeRemaining = 0;
+    cleared = true;
+}
+
+void ADSREchoAudioProcessor::Compensation::clear()
+{
+    if (cleared)
+        return;
+
+    line.reset();
+    fadeRemaining = 0;
+    cleared = true;
+}
+
+void ADSREchoAudioProcessor::Compensation::process(juce::AudioBuffer<float>& audio, int targetDelay)
+{
+    if (cleared)
+    {
+        // Nothing in the line to fade from
+        delay   = targetDelay;
+        cleared = false;
+    }
+    else if (targetDelay != delay)
+    {
+        // Mid-fade, carry on out of whichever tap is still the louder one
+        if (fadeRemaining * 2 <= fadeLength)
+            fadeFrom = delay;
+
+        delay         = targetDelay;
+        fadeRemaining = fadeLength;
+    }
+
+    const int numSamples = audio.getNumSamples();
+
+    if (fadeRemaining <= 0)
+    {
+        juce::dsp::AudioBlock<float> block(audio);
+        line.setDelay((float) delay);
+        line.process(juce::dsp::ProcessContextReplacing<float>(block));
+        return;
+    }
+
+    // Both taps read the same line; only the second moves the read pointer on
+    for (int ch = 0; ch < audio.getNumChannels(); ++ch)
+    {
+        auto* data = audio.getWritePointer(ch);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            line.pushSample(ch, data[i]);
+
+            const float from = line.popSample(ch, (float) fadeFrom, false);
+            const float to   = line.popSample(ch, (float) delay,    true);
+            const float t    = (float) juce::jmax(0, fadeRemaining - i) / (float) fadeLength;
+
+            data[i] = to + t * (from - to);
+        }
+    }
+
+    fadeRemaining = juce::jmax(0, fadeRemaining - numSamples);
 }
 
 void ADSREchoAudioProcessor::releaseResources()
@@ -142,6 +253,17 @@ void ADSREchoAudioProcessor::releaseResources()
     }
 }
 
+void ADSREchoAudioProcessor::setNonRealtime (bool isNonRealtime) noexcept
+{
+    juce::AudioProcessor::setNonRealtime (isNonRealtime);
+
+    for (auto& chain : slots)
+    {
+        for (auto& slot : chain)
+            slot->setNonRealtime(isNonRealtime);
+    }
+}
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool ADSREchoAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -179,6 +301,11 @@ void ADSREchoAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
         masterDryBuffer.getNumChannels(),
         buffer.getNumSamples(),
         false, false, true);
+
+    alignedDryBuffer.setSize(
+        alignedDryBuffer.getNumChannels(),
+        buffer.getNumSamples(),
+        false, false, true);
     
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -206,8 +333,45 @@ void ADSREchoAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     buffer.clear();
     // Process the audio through each module slot effect
     bool parallelEnabled = apvts.getRawParameterValue("parallelEnabled")->load();
+    const int numActiveChains = NUM_CHAINS - !parallelEnabled;
 
-    for (int chainIndex = 0; chainIndex < NUM_CHAINS - !parallelEnabled; chainIndex++)
+    // ===== Latency =====
+    // Modules settle their latency for the block first, so what is read here
+    // is what they run at
+    for (int chainIndex = 0; chainIndex < numActiveChains; chainIndex++)
+        for (auto& slot : slots[chainIndex])
+            slot->updateLatency();
+
+    int chainLatency[NUM_CHAINS] {};
+    int totalLatency = 0;
+
+    for (int chainIndex = 0; chainIndex < numActiveChains; chainIndex++)
+    {
+        chainLatency[chainIndex] = getChainLatency(chainIndex);
+        totalLatency = juce::jmax(totalLatency, chainLatency[chainIndex]);
+    }
+
+    if (totalLatency != currentLatencySamples)
+    {
+        currentLatencySamples = totalLatency;
+        latencyToReport.store(totalLatency);
+        triggerAsyncUpdate();
+    }
+
+    // Dry signal for the chain mixes, lined up with the chains' output. The
+    // lines run even at zero delay, so they hold recent audio when a delay
+    // fades in.
+    for (int ch = 0; ch < totalNumInputChannels; ++ch)
+        alignedDryBuffer.copyFrom(ch, 0, masterDryBuffer, ch, 0, numSamples);
+
+    dryCompensation.process(alignedDryBuffer, totalLatency);
+
+    // A chain that isn't processed doesn't run its line either, so what the
+    // line holds would be stale by the time the chain comes back
+    for (int chainIndex = numActiveChains; chainIndex < NUM_CHAINS; chainIndex++)
+        chainCompensation[chainIndex].clear();
+
+    for (int chainIndex = 0; chainIndex < numActiveChains; chainIndex++)
     {
 
         chainTempBuffer.clear();
@@ -221,6 +385,9 @@ void ADSREchoAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
             slot->process(chainTempBuffer, midiMessages, getPlayHead());
         }
 
+        // Pad a faster chain out to the slowest one
+        chainCompensation[chainIndex].process(chainTempBuffer, totalLatency - chainLatency[chainIndex]);
+
         // ===== Chain mix =====
         float wet = apvts.getRawParameterValue("chain_" + juce::String(chainIndex) + ".masterMix")->load();
         float dry = 1.0f - wet;
@@ -228,7 +395,7 @@ void ADSREchoAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
         for (int ch = 0; ch < totalNumInputChannels; ++ch)
         {
             auto* wetData = chainTempBuffer.getWritePointer(ch);
-            auto* dryData = masterDryBuffer.getReadPointer(ch);
+            auto* dryData = alignedDryBuffer.getReadPointer(ch);
 
             for (int i = 0; i < numSamples; ++i)
                 wetData[i] = dryData[i] * dry + wetData[i] * wet;
@@ -433,15 +600,31 @@ juce::AudioProcessorValueTreeState::ParameterLayout ADSREchoAudioProcessor::crea
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".convIrGain", "Conv IR Gain (dB)",
                 juce::NormalisableRange<float>(-18.0f, 18.0f, 0.1f), 0.0f));
 
+            layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".convIrLength", "Conv IR Length (s)",
+                juce::NormalisableRange<float>(0.1f, 20.0f, 0.01f, 0.4f), 20.0f));  // max = full IR
+
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".convLowCut", "Conv Low Cut (Hz)",
                 juce::NormalisableRange<float>(20.0f, 1000.0f, 1.0f, 0.3f), 80.0f));
 
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".convHighCut", "Conv High Cut (Hz)",
                 juce::NormalisableRange<float>(2000.0f, 20000.0f, 1.0f, 0.3f), 12000.0f));
 
+            layout.add(std::make_unique<juce::AudioParameterBool>(prefix + ".convBakeTone", "Conv Bake Tone Into IR", true));
+
+            layout.add(std::make_unique<juce::AudioParameterBool>(prefix + ".convMidInput", "Conv Mono IR Mid Input", false));
+
+            layout.add(std::make_unique<juce::AudioParameterBool>(prefix + ".convHybridTail", "Conv Algorithmic Late Tail", false));
+
+            layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".convEarlyMs", "Conv Early Part (ms)",
+                juce::NormalisableRange<float>(50.0f, 250.0f, 1.0f), 120.0f));
+
             layout.add(std::make_unique<juce::AudioParameterChoice>(prefix + ".reverbType", "Type",
                 juce::StringArray{ "Datorro Hall", "Hybrid Plate" }, 0));
 
+            // Delay-line read quality for Delay and Reverb - order matches DelayInterpolation
+            layout.add(std::make_unique<juce::AudioParameterChoice>(prefix + ".interpolation", "Interpolation",
+                juce::StringArray{ "Linear", "Lagrange", "Thiran" }, 0));
+
             // Delay BPM Sync
             layout.add(std::make_unique<juce::AudioParameterBool>(prefix + ".delaySyncEnabled", "Delay BPM Sync", false));
 
@@ -468,6 +651,28 @@ juce::AudioProcessorValueTreeState::ParameterLayout ADSREchoAudioProcessor::crea
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".delayHighpass", "Delay Highpass",
                 juce::NormalisableRange<float>(20.0f, 5000.0f, 1.0f, 0.3f), 20.0f));
 
+            // Delay Taps - extra read heads at multiples of the delay time
+            layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".delayTaps", "Delay Taps",
+                juce::NormalisableRange<float>(0.0f, (float) BasicDelay::kMaxTaps, 1.0f), 0.0f));
+
+            for (int t = 1; t <= BasicDelay::kMaxTaps; ++t)
+            {
+                const juce::String tapID   = prefix + ".delayTap" + juce::String(t);
+                const juce::String tapName = "Delay Tap " + juce::String(t);
+
+                layout.add(std::make_unique<juce::AudioParameterFloat>(tapID + "Time", tapName + " Time",
+                    juce::NormalisableRange<float>(0.05f, 2.0f, 0.01f), 0.25f * (float) t));
+
+                layout.add(std::make_unique<juce::AudioParameterFloat>(tapID + "Level", tapName + " Level",
+                    juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 1.0f - 0.1f * (float) t));
+
+                layout.add(std::make_unique<juce::AudioParameterFloat>(tapID + "Pan", tapName + " Pan",
+                    juce::NormalisableRange<float>(-1.0f, 1.0f, 0.01f), (t % 2 == 1) ? -0.5f : 0.5f));
+
+                layout.add(std::make_unique<juce::AudioParameterFloat>(tapID + "Lowpass", tapName + " Lowpass",
+                    juce::NormalisableRange<float>(200.0f, 20000.0f, 1.0f, 0.3f), 20000.0f));
+            }
+
             // 3-Band EQ
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".eqLowFreq", "Low Freq",
                 juce::NormalisableRange<float>(20.0f, 500.0f, 1.0f, 0.4f), 200.0f));
@@ -514,6 +719,13 @@ juce::AudioProcessorValueTreeState::ParameterLayout ADSREchoAudioProcessor::crea
 
             layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".compOutput", "Comp Output",
                 juce::NormalisableRange<float>(-18.0f, 18.0f, 0.1f), 0.0f));
+
+            // Adds latency - reported to the host. Every change is a latency
+            // change, so it is left out of automation and moves in 0.5 ms
+            // steps - dragging it doesn't re-report on every pixel.
+            layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + ".compLookahead", "Comp Lookahead (ms)",
+                juce::NormalisableRange<float>(0.0f, BasicCompressor::kMaxLookaheadMs, 0.5f), 0.0f,
+                juce::AudioParameterFloatAttributes().withAutomatable(false)));
         }
     }
 
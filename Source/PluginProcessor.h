@@ -37,7 +37,8 @@
 */
 
 
-class ADSREchoAudioProcessor  : public juce::AudioProcessor, public juce::ChangeBroadcaster
+class ADSREchoAudioProcessor  : public juce::AudioProcessor, public juce::ChangeBroadcaster,
+                                private IRBank::Listener, private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -47,6 +48,7 @@ public:
     //==============================================================================
     void prepareToPlay (double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void setNonRealtime (bool isNonRealtime) noexcept override;
 
    #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
@@ -107,10 +109,53 @@ private:
 
     std::shared_ptr<IRBank> irBank;
 
+    // IR discovery finished - the editor's IR menus need the new list
+    void irListChanged() override;
+
     // Pre-allocated buffer for dry signal (avoids allocation in processBlock)
     juce::AudioBuffer<float> masterDryBuffer;
     juce::AudioBuffer<float> chainTempBuffer;
 
+    // Latency compensation. Module latencies (compressor lookahead) add up
+    // along a chain; the dry signal and every chain are held back to the
+    // slowest chain so the parallel mix stays aligned, and that total is
+    // what the host is told.
+    using CompensationDelay = juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::None>;
+
+    // One compensation line and the delay it runs at, audio thread. A new
+    // delay is crossfaded to over the compressor's lookahead fade time, across
+    // as many blocks as that takes, so the lines move with the chains.
+    struct Compensation
+    {
+        CompensationDelay line;
+
+        int delay         = 0;
+        int fadeFrom      = 0;   // delay being faded out
+        int fadeRemaining = 0;
+        int fadeLength    = 1;
+        bool cleared      = true;   // nothing pushed since prepare() or clear()
+
+        void prepare(const juce::dsp::ProcessSpec& spec, int maxDelay);
+        void process(juce::AudioBuffer<float>& audio, int targetDelay);
+
+        // For a chain that stops being processed - when it comes back its
+        // line starts out silent at the delay it needs then, with no fade
+        void clear();
+    };
+
+    Compensation dryCompensation;
+    Compensation chainCompensation[NUM_CHAINS];
+    juce::AudioBuffer<float> alignedDryBuffer;
+
+    int maxLatencySamples     = 0;
+    int currentLatencySamples = 0;        // audio thread
+    std::atomic<int> latencyToReport { 0 };
+
+    int getChainLatency(int chainIndex) const;
+
+    // setLatencySamples() on the message thread
+    void handleAsyncUpdate() override;
+
     struct PendingMove
     {
         int chainIndex = -1;
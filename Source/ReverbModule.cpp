@@ -33,6 +33,11 @@ void ReverbModule::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& m
     datorroReverb.setParameters(params);
     hybridPlateReverb.setParameters(params);
 
+    const auto interpolation = static_cast<DelayInterpolation>(
+        static_cast<int>(state.getRawParameterValue(moduleID + ".interpolation")->load()));
+    datorroReverb.setInterpolation(interpolation);
+    hybridPlateReverb.setInterpolation(interpolation);
+
     if (*state.getRawParameterValue(moduleID + ".enabled") == true) 
     { 
         if (static_cast<int>(state.getRawParameterValue(moduleID + ".reverbType")->load()) == 0)
@@ -57,7 +62,8 @@ std::vector<juce::String> ReverbModule::getUsedParameters() const
        "damping",
        "modRate",
        "modDepth",
-       "preDelay"
+       "preDelay",
+       "interpolation"
     };
 }
 
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    SlotMeterComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "SlotMeterComponent.h"
+
+namespace
+{
+    // Instant rise, ~20 dB/s fall at 60 Hz (as CompressorDisplayComponent)
+    void follow(float& displayDb, float newDb)
+    {
+        const float decayPerFrame = 20.0f / 60.0f;
+
+        if (newDb > displayDb)
+            displayDb = newDb;
+        else
+            displayDb = juce::jmax(displayDb - decayPerFrame, newDb);
+    }
+
+    float toDb(float gain)
+    {
+        return juce::Decibels::gainToDecibels(gain, -100.0f);
+    }
+}
+
+SlotMeterComponent::SlotMeterComponent(ModuleMeter& meterToShow)
+    : meter(meterToShow)
+{
+    meter.attach();
+    startTimerHz(60);
+}
+
+SlotMeterComponent::~SlotMeterComponent()
+{
+    meter.detach();
+}
+
+void SlotMeterComponent::timerCallback()
+{
+    ModuleMeter::Reading reading;
+
+    // Nothing new (transport stopped, slot empty): let the bars fall
+    if (meter.read(reading) && onReading)
+        onReading(reading);
+
+    follow(inputRmsDb,   toDb(reading.inputRms));
+    follow(inputPeakDb,  toDb(reading.inputPeak));
+    follow(outputRmsDb,  toDb(reading.outputRms));
+    follow(outputPeakDb, toDb(reading.outputPeak));
+
+    repaint();
+}
+
+void SlotMeterComponent::paint(juce::Graphics& g)
+{
+    auto bounds = getLocalBounds();
+
+    const int meterW = (bounds.getWidth() - 2) / 2;
+
+    drawMeter(g, bounds.removeFromLeft(meterW), inputRmsDb, inputPeakDb, "IN");
+    bounds.removeFromLeft(2);
+    drawMeter(g, bounds, outputRmsDb, outputPeakDb, "OUT");
+}
+
+void SlotMeterComponent::drawMeter(juce::Graphics& g,
+                                   juce::Rectangle<int> area,
+                                   float rmsDb,
+                                   float peakDb,
+                                   const juce::String& label) const
+{
+    auto barRect = area;
+
+    // Label at the bottom
+    auto labelRect = barRect.removeFromBottom(14);
+    g.setColour(juce::Colours::lightgrey);
+    g.setFont(9.0f);
+    g.drawText(label, labelRect, juce::Justification::centred);
+
+    // Background
+    g.setColour(juce::Colour(0xff2a2a2a));
+    g.fillRect(barRect);
+
+    auto toY = [&](float db)
+    {
+        const float norm = juce::jlimit(0.0f, 1.0f, (db - meterFloor) / (meterCeil - meterFloor));
+        return barRect.getBottom() - (int)(norm * barRect.getHeight());
+    };
+
+    // RMS bar: green -> yellow -> red
+    juce::ColourGradient grad(
+        juce::Colours::green, (float)barRect.getX(), (float)barRect.getBottom(),
+        juce::Colours::red,   (float)barRect.getX(), (float)barRect.getY(),
+        false);
+    grad.addColour(0.75, juce::Colours::yellow);
+
+    g.setGradientFill(grad);
+    g.fillRect(barRect.withTop(toY(rmsDb)));
+
+    // Peak tick
+    if (peakDb > meterFloor)
+    {
+        g.setColour(juce::Colours::white.withAlpha(0.9f));
+        g.fillRect(barRect.getX(), toY(peakDb) - 1, barRect.getWidth(), 2);
+    }
+
+    // Border
+    g.setColour(juce::Colours::darkgrey);
+    g.drawRect(barRect);
+}
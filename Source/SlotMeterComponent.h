@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    SlotMeterComponent.h
+    Input / output meters shown on every slot editor.
+
+    Two vertical bars, IN and OUT, each with the RMS level filled and the
+    peak as a tick, read from the slot's ModuleMeter. The meter has a single
+    reader, so this component is it - editors that show more of the reading
+    (the compressor's gain reduction) take it through onReading.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#if __has_include("JuceHeader.h")
+  #include "JuceHeader.h"
+#else
+  #include <juce_audio_basics/juce_audio_basics.h>
+  #include <juce_events/juce_events.h>
+  #include <juce_graphics/juce_graphics.h>
+  #include <juce_gui_basics/juce_gui_basics.h>
+#endif
+
+#include "ModuleMeter.h"
+
+class SlotMeterComponent : public juce::Component,
+                           private juce::Timer
+{
+public:
+    explicit SlotMeterComponent(ModuleMeter& meterToShow);
+    ~SlotMeterComponent() override;
+
+    // Called with every reading, on the message thread
+    std::function<void(const ModuleMeter::Reading&)> onReading;
+
+    void paint(juce::Graphics&) override;
+
+private:
+    ModuleMeter& meter;
+
+    // Smoothed display values in dB (UI thread only)
+    float inputRmsDb   = -100.0f;
+    float inputPeakDb  = -100.0f;
+    float outputRmsDb  = -100.0f;
+    float outputPeakDb = -100.0f;
+
+    static constexpr float meterFloor = -60.0f;
+    static constexpr float meterCeil  =  6.0f;
+
+    void timerCallback() override;
+
+    void drawMeter(juce::Graphics& g,
+                   juce::Rectangle<int> area,
+                   float rmsDb,
+                   float peakDb,
+                   const juce::String& label) const;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SlotMeterComponent)
+};
@@ -2,6 +2,13 @@
 #include <catch2/catch_approx.hpp>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
+#include "PartitionedConvolver.h"
+#include "CustomDelays.h"
+#include "BasicCompressor.h"
+#include "FastMath.h"
+
+#include <thread>
+#include <vector>
 
 using Catch::Approx;
 
@@ -31,6 +38,578 @@ TEST_CASE("DSP Algorithm Tests", "[dsp]")
     }
 }
 
+TEST_CASE("Convolution kernel changes", "[dsp][convolution]")
+{
+    SECTION("Second IR change within the crossfade still plays")
+    {
+        // Single-tap IRs, so the output for a unit impulse is the IR's gain
+        auto makeIR = [] (float gain)
+        {
+            juce::AudioBuffer<float> ir(2, 16);
+            ir.clear();
+            ir.setSample(0, 0, gain);
+            ir.setSample(1, 0, gain);
+            return ir;
+        };
+
+        const int blockSize = 64;
+        PartitionedConvolver convolver;
+        convolver.setNonRealtime(true);
+        convolver.prepare({ 48000.0, (juce::uint32) blockSize, 2 });
+        convolver.loadImpulseResponse(makeIR(1.0f));
+
+        juce::AudioBuffer<float> buffer(2, blockSize);
+
+        // An impulse at the top of every block, so each block's first sample
+        // is the gain of whatever mix of kernels is playing
+        auto processBlock = [&]
+        {
+            buffer.clear();
+            buffer.setSample(0, 0, 1.0f);
+            buffer.setSample(1, 0, 1.0f);
+
+            juce::dsp::AudioBlock<float> block(buffer);
+            convolver.process(juce::dsp::ProcessContextReplacing<float>(block));
+            return buffer.getSample(0, 0);
+        };
+
+        for (int i = 0; i < 4; ++i)
+            REQUIRE(processBlock() == Approx(1.0f));
+
+        // B starts fading in, C arrives while it still is
+        convolver.loadImpulseResponse(makeIR(0.5f));
+        processBlock();
+        convolver.loadImpulseResponse(makeIR(0.25f));
+
+        // C swaps in once B's crossfade is over and A's state has been freed
+        // by the resident worker. The timeout only guards against a hang.
+        const auto deadline = juce::Time::getMillisecondCounter() + 10000;
+
+        while ((convolver.isCrossfading() || convolver.isKernelPending())
+               && juce::Time::getMillisecondCounter() < deadline)
+        {
+            // Never drops out or jumps while the kernels change
+            const float gain = processBlock();
+            REQUIRE(gain > 0.2f);
+            REQUIRE(gain < 1.2f);
+
+            std::this_thread::yield();
+        }
+
+        REQUIRE_FALSE(convolver.isCrossfading());
+        REQUIRE_FALSE(convolver.isKernelPending());
+
+        processBlock();
+        REQUIRE(buffer.getSample(0, 0) == Approx(0.25f));
+        REQUIRE(buffer.getSample(1, 0) == Approx(0.25f));
+    }
+}
+
+namespace
+{
+    // Sparse IR: a tap every 40 samples or so, at random positions and gains,
+    // plus the first and last sample. Reaches every stage of the partition
+    // schedule while keeping the direct-form reference cheap.
+    juce::AudioBuffer<float> makeSparseIR(int numChannels, int length, juce::int64 seed)
+    {
+        juce::Random random(seed);
+        juce::AudioBuffer<float> ir(numChannels, length);
+        ir.clear();
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            ir.setSample(ch, 0, 1.0f);
+            ir.setSample(ch, length - 1, 0.5f);
+
+            for (int i = 0; i < length / 40; ++i)
+                ir.setSample(ch, random.nextInt(length), random.nextFloat() * 2.0f - 1.0f);
+        }
+
+        return ir;
+    }
+
+    juce::AudioBuffer<float> makeNoise(int numChannels, int numSamples, juce::int64 seed)
+    {
+        juce::Random random(seed);
+        juce::AudioBuffer<float> noise(numChannels, numSamples);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            for (int n = 0; n < numSamples; ++n)
+                noise.setSample(ch, n, random.nextFloat() * 2.0f - 1.0f);
+
+        return noise;
+    }
+
+    // out[o] += in[i] * ir[irChannel], delayed by preDelay samples
+    void convolveDirect(const juce::AudioBuffer<float>& in, int inChannel,
+                        const juce::AudioBuffer<float>& ir, int irChannel,
+                        int preDelay, juce::AudioBuffer<float>& out, int outChannel)
+    {
+        const float* h = ir.getReadPointer(irChannel);
+        const float* x = in.getReadPointer(inChannel);
+        float* y       = out.getWritePointer(outChannel);
+
+        for (int j = 0; j < ir.getNumSamples(); ++j)
+        {
+            if (h[j] == 0.0f)
+                continue;
+
+            for (int n = j + preDelay; n < out.getNumSamples(); ++n)
+                y[n] += h[j] * x[n - j - preDelay];
+        }
+    }
+
+    // Runs the input through the engine in blocks of the given (cycled)
+    // sizes. Offline, so the result never depends on the workers' timing.
+    juce::AudioBuffer<float> runEngine(PartitionedConvolver& engine, const juce::AudioBuffer<float>& input,
+                                       const std::vector<int>& blockSizes)
+    {
+        juce::AudioBuffer<float> output(input);
+        size_t nextSize = 0;
+
+        for (int start = 0; start < output.getNumSamples();)
+        {
+            const int n = juce::jmin(blockSizes[nextSize++ % blockSizes.size()], output.getNumSamples() - start);
+
+            juce::dsp::AudioBlock<float> block(output.getArrayOfWritePointers(),
+                                               (size_t) output.getNumChannels(), (size_t) start, (size_t) n);
+            engine.process(juce::dsp::ProcessContextReplacing<float>(block));
+            start += n;
+        }
+
+        return output;
+    }
+
+    // Largest difference relative to the reference's peak
+    float relativeError(const juce::AudioBuffer<float>& actual, const juce::AudioBuffer<float>& expected)
+    {
+        float error = 0.0f, peak = 0.0f;
+
+        for (int ch = 0; ch < expected.getNumChannels(); ++ch)
+        {
+            for (int n = 0; n < expected.getNumSamples(); ++n)
+            {
+                error = juce::jmax(error, std::abs(actual.getSample(ch, n) - expected.getSample(ch, n)));
+                peak  = juce::jmax(peak,  std::abs(expected.getSample(ch, n)));
+            }
+        }
+
+        return error / juce::jmax(peak, 1.0e-9f);
+    }
+
+    const std::vector<int> oddBlockSizes { 1, 7, 97, 128, 333, 500 };
+    constexpr int maxBlockSize = 512;
+    constexpr float tolerance  = 1.0e-4f;
+}
+
+TEST_CASE("Partitioned convolution matches direct convolution", "[dsp][convolution]")
+{
+    const auto input = makeNoise(2, 40000, 7);
+
+    auto prepareEngine = [] (PartitionedConvolver& engine, int headSize)
+    {
+        engine.setHeadSize(headSize);
+        engine.setNonRealtime(true);
+        engine.prepare({ 48000.0, (juce::uint32) maxBlockSize, 2 });
+    };
+
+    auto stereoReference = [&input] (const juce::AudioBuffer<float>& ir, int preDelay)
+    {
+        juce::AudioBuffer<float> expected(2, input.getNumSamples());
+        expected.clear();
+
+        for (int ch = 0; ch < 2; ++ch)
+            convolveDirect(input, ch, ir, ch, preDelay, expected, ch);
+
+        return expected;
+    };
+
+    SECTION("Head sizes 16, 128 and 1024")
+    {
+        for (int headSize : { 16, 128, 1024 })
+        {
+            INFO("head size " << headSize);
+
+            // Long enough to reach the worker stages after even the largest head
+            const auto ir = makeSparseIR(2, 20000, headSize);
+
+            PartitionedConvolver engine;
+            prepareEngine(engine, headSize);
+            engine.loadImpulseResponse(ir);
+
+            REQUIRE(relativeError(runEngine(engine, input, oddBlockSizes), stereoReference(ir, 0)) < tolerance);
+            REQUIRE(engine.getUnderruns() == 0);
+        }
+    }
+
+    SECTION("Host block sizes off the partition grid")
+    {
+        const auto ir = makeSparseIR(2, 12000, 3);
+
+        for (const auto& sizes : std::vector<std::vector<int>> { { 1 }, { 100 }, { 511 }, { 3, 250, 17 } })
+        {
+            INFO("first block size " << sizes.front());
+
+            PartitionedConvolver engine;
+            prepareEngine(engine, 64);
+            engine.loadImpulseResponse(ir);
+
+            REQUIRE(relativeError(runEngine(engine, input, sizes), stereoReference(ir, 0)) < tolerance);
+        }
+    }
+
+    SECTION("Pre-delay")
+    {
+        const auto ir = makeSparseIR(2, 12000, 4);
+
+        for (int preDelay : { 1, 333, 4800 })
+        {
+            INFO("pre-delay " << preDelay);
+
+            PartitionedConvolver engine;
+            prepareEngine(engine, 128);
+            engine.setPreDelay(preDelay);
+            engine.loadImpulseResponse(ir);
+
+            REQUIRE(relativeError(runEngine(engine, input, oddBlockSizes), stereoReference(ir, preDelay)) < tolerance);
+        }
+    }
+
+    SECTION("Mid input")
+    {
+        const auto ir = makeSparseIR(1, 12000, 5);
+
+        PartitionedConvolver engine;
+        prepareEngine(engine, 128);
+        engine.setMidInput(true);
+        engine.loadImpulseResponse(ir);
+
+        // (L + R) / 2 through the mono IR, on both outputs
+        juce::AudioBuffer<float> mid(1, input.getNumSamples());
+        mid.clear();
+        mid.addFrom(0, 0, input, 0, 0, input.getNumSamples(), 0.5f);
+        mid.addFrom(0, 0, input, 1, 0, input.getNumSamples(), 0.5f);
+
+        juce::AudioBuffer<float> expected(2, input.getNumSamples());
+        expected.clear();
+        convolveDirect(mid, 0, ir, 0, 0, expected, 0);
+        expected.copyFrom(1, 0, expected, 0, 0, input.getNumSamples());
+
+        REQUIRE(relativeError(runEngine(engine, input, oddBlockSizes), expected) < tolerance);
+    }
+
+    SECTION("Four-channel IR runs true stereo")
+    {
+        const auto ir = makeSparseIR(PartitionedConvolver::kTrueStereoChannels, 12000, 6);
+
+        PartitionedConvolver engine;
+        prepareEngine(engine, 128);
+        engine.loadImpulseResponse(ir);
+
+        // IR channels are LL, LR, RL, RR
+        juce::AudioBuffer<float> expected(2, input.getNumSamples());
+        expected.clear();
+
+        for (int in = 0; in < 2; ++in)
+            for (int out = 0; out < 2; ++out)
+                convolveDirect(input, in, ir, in * 2 + out, 0, expected, out);
+
+        REQUIRE(relativeError(runEngine(engine, input, oddBlockSizes), expected) < tolerance);
+    }
+
+    SECTION("Stages streamed from a spill file")
+    {
+        const auto ir = makeSparseIR(2, 30000, 8);
+
+        // Everything past the first 4000 samples is streamed
+        auto kernel = PartitionedConvolver::createKernel(ir, 128, false, 4000);
+        REQUIRE(kernel->spill != nullptr);
+
+        PartitionedConvolver engine;
+        prepareEngine(engine, 128);
+        engine.setKernel(kernel);
+
+        REQUIRE(relativeError(runEngine(engine, input, oddBlockSizes), stereoReference(ir, 0)) < tolerance);
+        REQUIRE(engine.getUnderruns() == 0);
+    }
+}
+
+TEST_CASE("Fractional delay readers", "[dsp][delay]")
+{
+    // Samples are pushed before they are read, so a delay of D puts the
+    // impulse D - 1 samples later
+    constexpr float delay  = 10.5f;
+    constexpr int   length = 64;
+
+    // Impulse response of the head at a fixed delay - per sample, or through
+    // readBlock()/pushBlock() in blocks of four
+    auto impulseResponse = [] (DelayInterpolation mode, bool blocks)
+    {
+        DelayLineWithSampleAccess<float> line(32);
+        line.prepare({ 48000.0, 4, 1 });
+        line.setInterpolation(mode);
+
+        std::vector<float> input((size_t) length, 0.0f), output((size_t) length);
+        input[0] = 1.0f;
+
+        if (blocks)
+        {
+            for (int start = 0; start < length; start += 4)
+            {
+                line.readBlock(0, delay, output.data() + start, 4);
+                line.pushBlock(0, input.data() + start, 4);
+            }
+        }
+        else
+        {
+            for (int n = 0; n < length; ++n)
+            {
+                line.pushSample(0, input[(size_t) n]);
+                output[(size_t) n] = line.readFractional(0, delay);
+            }
+        }
+
+        return output;
+    };
+
+    // Centre of mass of the response - its group delay at DC
+    auto centroid = [] (const std::vector<float>& h)
+    {
+        double sum = 0.0, weighted = 0.0;
+
+        for (size_t n = 0; n < h.size(); ++n)
+        {
+            sum      += h[n];
+            weighted += h[n] * (double) n;
+        }
+
+        return weighted / sum;
+    };
+
+    SECTION("Lagrange3 is the four-tap half-sample interpolator")
+    {
+        for (bool blocks : { false, true })
+        {
+            INFO((blocks ? "block reads" : "per-sample reads"));
+            const auto h = impulseResponse(DelayInterpolation::Lagrange3, blocks);
+
+            for (int n = 0; n < length; ++n)
+            {
+                const float expected = (n == 9 || n == 10) ? 9.0f / 16.0f
+                                     : (n == 8 || n == 11) ? -1.0f / 16.0f
+                                                           : 0.0f;
+                REQUIRE(h[(size_t) n] == Approx(expected).margin(1.0e-6));
+            }
+
+            REQUIRE(centroid(h) == Approx(delay - 1.0f).margin(1.0e-6));
+        }
+    }
+
+    SECTION("Thiran is the first-order allpass for the fraction")
+    {
+        // 10.5 is read as 9 whole samples and a fraction of 1.5, which keeps
+        // the pole well inside the unit circle
+        const float alpha = (1.0f - 1.5f) / (1.0f + 1.5f);
+
+        for (bool blocks : { false, true })
+        {
+            INFO((blocks ? "block reads" : "per-sample reads"));
+            const auto h = impulseResponse(DelayInterpolation::Thiran, blocks);
+
+            for (int n = 0; n < length; ++n)
+            {
+                const float expected = n < 8  ? 0.0f
+                                     : n == 8 ? alpha
+                                              : (1.0f - alpha * alpha) * std::pow(-alpha, (float) (n - 9));
+                REQUIRE(h[(size_t) n] == Approx(expected).margin(1.0e-6));
+            }
+
+            REQUIRE(centroid(h) == Approx(delay - 1.0f).margin(1.0e-4));
+        }
+    }
+
+    SECTION("Block reads match per-sample reads on noise")
+    {
+        for (auto mode : { DelayInterpolation::Linear, DelayInterpolation::Lagrange3, DelayInterpolation::Thiran })
+        {
+            INFO("interpolation " << (int) mode);
+
+            DelayLineWithSampleAccess<float> perSample(256), block(256);
+
+            for (auto* line : { &perSample, &block })
+            {
+                line->prepare({ 48000.0, 32, 1 });
+                line->setInterpolation(mode);
+            }
+
+            juce::Random random(3);
+            std::vector<float> input(32), expected(32), actual(32);
+
+            for (int b = 0; b < 40; ++b)
+            {
+                // A new fixed delay each block, always past the block's writes
+                const float d = 34.0f + 100.0f * random.nextFloat();
+
+                for (auto& x : input)
+                    x = random.nextFloat() * 2.0f - 1.0f;
+
+                for (int n = 0; n < 32; ++n)
+                {
+                    perSample.pushSample(0, input[(size_t) n]);
+                    expected[(size_t) n] = perSample.readFractional(0, d);
+                }
+
+                block.readBlock(0, d, actual.data(), 32);
+                block.pushBlock(0, input.data(), 32);
+
+                for (int n = 0; n < 32; ++n)
+                    REQUIRE(actual[(size_t) n] == Approx(expected[(size_t) n]).margin(1.0e-5));
+            }
+        }
+    }
+}
+
+TEST_CASE("Compressor level maths", "[dsp][compressor]")
+{
+    SECTION("FastMath error bounds over the detector's range")
+    {
+        // Detector powers run from the 1e-18 floor up past +30 dBFS; gains
+        // from the -100 dB floor to the +18 dB output gain
+        double log2Error = 0.0, exp2Error = 0.0, dbError = 0.0, gainError = 0.0;
+
+        for (int i = 0; i <= 200000; ++i)
+        {
+            const float power = std::pow(10.0f, -18.0f + 21.0f * (float) i / 200000.0f);
+            log2Error = juce::jmax(log2Error, std::abs((double) FastMath::log2(power) - std::log2((double) power)));
+
+            const float gain = std::sqrt(power);
+            dbError = juce::jmax(dbError, std::abs((double) FastMath::gainToDecibels(gain, -200.0f)
+                                                   - 20.0 * std::log10((double) gain)));
+
+            const float exponent = -16.61f + 19.6f * (float) i / 200000.0f;
+            exp2Error = juce::jmax(exp2Error, std::abs((double) FastMath::exp2(exponent) / std::exp2((double) exponent) - 1.0));
+
+            // -100 dB itself is the floor, which is exactly 0
+            const float dB = -99.9f + 117.9f * (float) i / 200000.0f;
+            gainError = juce::jmax(gainError, std::abs((double) FastMath::decibelsToGain(dB)
+                                                       / std::pow(10.0, dB / 20.0) - 1.0));
+        }
+
+        // The bounds FastMath.h states
+        REQUIRE(log2Error < 3.0e-5);
+        REQUIRE(exp2Error < 5.0e-6);
+        REQUIRE(dbError   < 2.0e-4);
+        REQUIRE(gainError < 5.0e-6);
+    }
+
+    SECTION("Block passes follow the per-sample gain curve")
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize     = 256;
+        constexpr float threshold = -24.0f, ratio = 6.0f, attackMs = 5.0f, releaseMs = 300.0f;
+        constexpr float inputDb = 3.0f, outputDb = 2.0f;
+
+        BasicCompressor compressor;
+        compressor.setThreshold(threshold);
+        compressor.setRatio(ratio);
+        compressor.setAttack(attackMs);
+        compressor.setRelease(releaseMs);
+        compressor.setInputGain(inputDb);
+        compressor.setOutputGain(outputDb);
+        compressor.prepare({ sampleRate, (juce::uint32) blockSize, 2 });
+
+        // The compressor as it was before the block passes: every step per
+        // sample, in double, through libm
+        juce::dsp::FirstOrderTPTFilter<float> detector[2];
+        for (auto& filter : detector)
+        {
+            filter.prepare({ sampleRate, (juce::uint32) blockSize, 1 });
+            filter.setType(juce::dsp::FirstOrderTPTFilterType::lowpass);
+            filter.setCutoffFrequency(800.0f);
+        }
+
+        double envelope = 0.0, gainReduction = 0.0;
+
+        auto gainReductionDb = [&] (double levelDb)
+        {
+            const double kH = 3.0;
+
+            if (levelDb < threshold - kH)
+                return 0.0;
+
+            if (levelDb <= threshold + kH)
+            {
+                const double x = levelDb - (threshold - kH);
+                const double slope = 1.0 + (ratio - 1.0) * (x / 6.0) * (x / 6.0);
+                return (threshold - kH) + x / slope - levelDb;
+            }
+
+            return threshold + (levelDb - threshold) / ratio - levelDb;
+        };
+
+        auto referenceGain = [&] (float left, float right)
+        {
+            const float inL = left * juce::Decibels::decibelsToGain(inputDb);
+            const float inR = right * juce::Decibels::decibelsToGain(inputDb);
+            const float detL = detector[0].processSample(0, inL);
+            const float detR = detector[1].processSample(0, inR);
+
+            const double rms     = std::sqrt(0.5 * ((double) detL * detL + (double) detR * detR) + 1e-18);
+            const double levelDb = juce::Decibels::gainToDecibels((float) rms);
+
+            const double attackSamples = juce::jmax(0.1, attackMs / (1.0 + juce::jmax(0.0, levelDb - threshold) * 0.1))
+                                       * 0.001 * sampleRate;
+            const double envelopeDb     = juce::Decibels::gainToDecibels((float) envelope);
+            const double releaseSamples = juce::jmin(releaseMs * (1.0 + juce::jmax(0.0, envelopeDb - threshold) * 0.05),
+                                                     releaseMs * 2.0) * 0.001 * sampleRate;
+
+            const double coefficient = std::exp(-1.0 / (rms > envelope ? attackSamples : releaseSamples));
+            envelope = coefficient * envelope + (1.0 - coefficient) * rms;
+
+            const double target = gainReductionDb(juce::Decibels::gainToDecibels((float) envelope));
+            gainReduction = gainReduction * 0.9995 + target * 0.0005;
+
+            if (target < gainReduction)
+                gainReduction = gainReduction * 0.995 + target * 0.005;
+
+            return juce::Decibels::decibelsToGain((float) gainReduction) * juce::Decibels::decibelsToGain(outputDb)
+                 * juce::Decibels::decibelsToGain(inputDb);
+        };
+
+        // Bursts of loud noise between quiet stretches - attack, release and
+        // the knee all get exercised
+        juce::Random random(5);
+        juce::AudioBuffer<float> buffer(2, blockSize), input(2, blockSize);
+        double worstDb = 0.0;
+
+        for (int b = 0; b < 1500; ++b)
+        {
+            const float amplitude = (b / 50) % 2 != 0 ? 0.8f : 0.02f;
+
+            for (int ch = 0; ch < 2; ++ch)
+                for (int i = 0; i < blockSize; ++i)
+                    input.setSample(ch, i, amplitude * (random.nextFloat() * 2.0f - 1.0f));
+
+            for (int ch = 0; ch < 2; ++ch)
+                buffer.copyFrom(ch, 0, input, ch, 0, blockSize);
+
+            compressor.processBlock(buffer);
+
+            for (int i = 0; i < blockSize; ++i)
+            {
+                const float x = input.getSample(0, i);
+                const double expected = referenceGain(x, input.getSample(1, i));
+
+                if (std::abs(x) > 1.0e-3f)
+                    worstDb = juce::jmax(worstDb, std::abs(20.0 * std::log10(buffer.getSample(0, i) / (x * expected))));
+            }
+        }
+
+        REQUIRE(worstDb < 0.05);
+        REQUIRE(compressor.getCurrentGainReductionDb() == Approx(gainReduction).margin(0.05));
+    }
+}
+
 TEST_CASE("Audio Signal Tests", "[dsp][audio]")
 {
     SECTION("Null test - bypass should not alter signal")
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    IRPackBuilder - packs a folder of IR WAVs into an IRs.irpack archive
+
+    Usage: IRPackBuilder <ir folder> <output file> [rate ...]
+    Default rates: 44100 48000 96000
+
+  ==============================================================================
+*/
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "IRPack.h"
+
+int main(int argc, char* argv[])
+{
+    // IRCache and the format manager expect JUCE to be initialised
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    if (argc < 3)
+    {
+        std::cerr << "Usage: IRPackBuilder <ir folder> <output file> [rate ...]" << std::endl;
+        return 1;
+    }
+
+    const juce::File folder(juce::File::getCurrentWorkingDirectory().getChildFile(argv[1]));
+    const juce::File output(juce::File::getCurrentWorkingDirectory().getChildFile(argv[2]));
+
+    juce::Array<double> rates;
+    for (int i = 3; i < argc; ++i)
+        rates.add(juce::String(argv[i]).getDoubleValue());
+
+    if (rates.isEmpty())
+        rates = { 44100.0, 48000.0, 96000.0 };
+
+    // Same order IRBank's folder scan produces, so IR indices saved in
+    // sessions mean the same IR either way
+    auto sources = folder.findChildFiles(juce::File::findFiles, false, "*.wav;*.WAV");
+
+    struct FileSorter
+    {
+        static int compareElements(const juce::File& first, const juce::File& second)
+        {
+            return first.getFileName().compareNatural(second.getFileName());
+        }
+    };
+
+    FileSorter sorter;
+    sources.sort(sorter);
+
+    if (sources.isEmpty())
+    {
+        std::cerr << "No .wav files in " << folder.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (!IRPack::write(sources, rates, output))
+    {
+        std::cerr << "Failed to write " << output.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cout << "Packed " << sources.size() << " IRs into " << output.getFullPathName() << std::endl;
+    return 0;
+}